@@ -0,0 +1,394 @@
+#include "Arduino.h"
+#include "AnalogSampler.h"
+#include "wiring_private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// vendor driver headers have no c++ guards
+extern "C" {
+#include "drv_model_pub.h"
+#include "saradc_pub.h"
+#include "BkDriverTimer.h"
+#include "bk_timer_pub.h"
+extern OSStatus bk_timer_initialize_us(uint8_t timer_id, uint32_t time_us, void *callback);
+}
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+using namespace arduino;
+
+#define ADC_REGISTER_VAL_MAX    4096
+#define ADC_VOLTAGE_MAX         2400   // mv
+
+// one burst never takes more than a few ms, give up on a channel after this
+#define SAMPLER_CONV_TIMEOUT    20
+
+// the saradc has a single descriptor, so only one sampler runs at a time
+static AnalogSampler *__activeSampler = NULL;
+static saradc_desc_t __samplerDesc;
+
+extern "C" void __analog_sampler_conv_done(void)
+{
+    saradc_disable();
+
+    if (__activeSampler != NULL) {
+        __activeSampler->__convDone();
+    }
+}
+
+static void __analog_sampler_timer(UINT8 id)
+{
+    if (__activeSampler != NULL) {
+        __activeSampler->__slot();
+    }
+}
+
+static void __analog_sampler_thread(void *arg)
+{
+    ((AnalogSampler *)arg)->__run();
+}
+
+bool analogSamplerLatest(int channel, int *value)
+{
+    if (__activeSampler == NULL) {
+        return false;
+    }
+
+    return __activeSampler->__latest(channel, value);
+}
+
+AnalogSampler::AnalogSampler()
+{
+}
+
+AnalogSampler::~AnalogSampler()
+{
+    end();
+}
+
+bool AnalogSampler::begin(const pin_size_t *pins, uint8_t count, uint32_t rateHz, size_t frames)
+{
+    uint8_t i;
+    int chan;
+
+    if (__running || __activeSampler != NULL) {
+        return false;
+    }
+
+    if (pins == NULL || count == 0 || count > ANALOG_SAMPLER_MAX_CHANNELS ||
+        rateHz == 0 || rateHz > ANALOG_SAMPLER_MAX_RATE || frames == 0) {
+        return false;
+    }
+
+    for (i = 0; i < count; i++) {
+        chan = analogPinToChannel(pins[i]);
+        if (chan < 0) {
+            return false;
+        }
+        __chan[i] = (uint8_t)chan;
+        __last[i] = 0;
+        __decSum[i] = 0;
+    }
+    __count = count;
+    __decFill = 0;
+
+    __periodUs = (1000000 + rateHz / 2) / rateHz;
+    __scanPending = false;
+
+    // one extra frame tells a full ring from an empty one
+    __ringFrames = frames + 1;
+    __ring = (uint16_t *)malloc(__ringFrames * __count * sizeof(uint16_t));
+    __conv = (uint16_t *)malloc(__averaging * sizeof(uint16_t));
+    if (__blockCb != NULL) {
+        __block = (uint16_t *)malloc(__blockFrames * __count * sizeof(uint16_t));
+    }
+    if (__ring == NULL || __conv == NULL || (__blockCb != NULL && __block == NULL)) {
+        end();
+        return false;
+    }
+    __head = 0;
+    __tail = 0;
+    __blockFill = 0;
+
+    if (OPRT_OK != tal_semaphore_create_init(&__doneSem, 0, 1) ||
+        OPRT_OK != tal_semaphore_create_init(&__scanSem, 0, 1) ||
+        OPRT_OK != tal_semaphore_create_init(&__exitSem, 0, 1)) {
+        end();
+        return false;
+    }
+
+    __activeSampler = this;
+    __running = true;
+
+    THREAD_CFG_T thrd_param = {2048, THREAD_PRIO_1, (CHAR_T *)"analog_sampler"};
+    if (OPRT_OK != tal_thread_create_and_start(&__task, NULL, NULL, __analog_sampler_thread, this, &thrd_param)) {
+        __running = false;
+        __task = NULL;
+        end();
+        return false;
+    }
+
+    // the first scan starts right away, the timer paces the rest
+    __scanPending = true;
+    tal_semaphore_post(__scanSem);
+    bk_timer_initialize_us(BK_TIMER_SAMPLER_ID, __periodUs, (void *)__analog_sampler_timer);
+
+    return true;
+}
+
+void AnalogSampler::end(void)
+{
+    BOOL_T self = FALSE;
+
+    // the thread would wait for itself to exit
+    if (__task != NULL && OPRT_OK == tal_thread_is_self(__task, &self) && self) {
+        return;
+    }
+
+    if (__running) {
+        bk_timer_stop(BK_TIMER_SAMPLER_ID);
+        __running = false;
+        tal_semaphore_post(__scanSem);
+        tal_semaphore_wait(__exitSem, SEM_WAIT_FOREVER);
+        __task = NULL;
+    }
+
+    if (__activeSampler == this) {
+        __activeSampler = NULL;
+    }
+
+    if (__doneSem != NULL) {
+        tal_semaphore_release(__doneSem);
+        __doneSem = NULL;
+    }
+    if (__scanSem != NULL) {
+        tal_semaphore_release(__scanSem);
+        __scanSem = NULL;
+    }
+    if (__exitSem != NULL) {
+        tal_semaphore_release(__exitSem);
+        __exitSem = NULL;
+    }
+
+    free(__ring);
+    __ring = NULL;
+    free(__conv);
+    __conv = NULL;
+    free(__block);
+    __block = NULL;
+    __ringFrames = 0;
+    __head = 0;
+    __tail = 0;
+}
+
+void AnalogSampler::setAveraging(uint8_t conversions)
+{
+    if (__running) {
+        return;
+    }
+
+    __averaging = (conversions == 0) ? 1 : conversions;
+}
+
+void AnalogSampler::setDecimation(uint8_t factor)
+{
+    if (__running) {
+        return;
+    }
+
+    __decimation = (factor == 0) ? 1 : factor;
+}
+
+void AnalogSampler::onBlock(BlockCallback cb, size_t framesPerBlock, void *arg)
+{
+    if (__running) {
+        return;
+    }
+
+    __blockCb = (framesPerBlock > 0) ? cb : NULL;
+    __blockFrames = framesPerBlock;
+    __blockArg = arg;
+}
+
+size_t AnalogSampler::available(void)
+{
+    size_t head = __head;
+    size_t tail = __tail;
+
+    if (__ringFrames == 0) {
+        return 0;
+    }
+
+    return (head >= tail) ? (head - tail) : (__ringFrames - tail + head);
+}
+
+size_t AnalogSampler::read(uint16_t *frames, size_t maxFrames)
+{
+    size_t done = 0;
+    size_t tail = __tail;
+
+    while (done < maxFrames && tail != __head) {
+        memcpy(&frames[done * __count], &__ring[tail * __count], __count * sizeof(uint16_t));
+        tail = (tail + 1) % __ringFrames;
+        done++;
+    }
+
+    __asm__ __volatile__("" ::: "memory");
+    __tail = tail;
+
+    return done;
+}
+
+bool AnalogSampler::__latest(int channel, int *value)
+{
+    uint8_t i;
+
+    // the saradc is not given to other channels while the sampler runs
+    *value = 0;
+    for (i = 0; i < __count; i++) {
+        if (__chan[i] == channel) {
+            *value = __last[i];
+            break;
+        }
+    }
+
+    return true;
+}
+
+void AnalogSampler::__convDone(void)
+{
+    tal_semaphore_post(__doneSem);
+}
+
+void AnalogSampler::__slot(void)
+{
+    // the scan of the last slot still runs, this one is lost
+    if (__scanPending) {
+        __missed++;
+        return;
+    }
+
+    __scanPending = true;
+    tal_semaphore_post(__scanSem);
+}
+
+bool AnalogSampler::__convert(uint8_t channel, uint16_t *value)
+{
+    UINT32 status;
+    DD_HANDLE adc_hdl;
+    uint32_t sum = 0;
+    uint16_t mv = 0;
+    uint8_t i;
+
+    memset(&__samplerDesc, 0, sizeof(__samplerDesc));
+    __samplerDesc.mode = (ADC_CONFIG_MODE_CONTINUE << 0)
+                        | (ADC_CONFIG_MODE_4CLK_DELAY << 2)
+                        | (ADC_CONFIG_MODE_SHOULD_OFF);
+    __samplerDesc.channel = channel + 1;
+    __samplerDesc.data_buff_size = __averaging;
+    __samplerDesc.pData = (UINT16 *)__conv;
+    __samplerDesc.pre_div = 8;
+    __samplerDesc.samp_rate = 0x20;
+    __samplerDesc.p_Int_Handler = __analog_sampler_conv_done;
+
+    // a burst that finished after its timeout left a post behind
+    xSemaphoreTake((SemaphoreHandle_t)__doneSem, 0);
+
+    GLOBAL_INT_DECLARATION();
+    GLOBAL_INT_DISABLE();
+    adc_hdl = ddev_open(SARADC_DEV_NAME, &status, (UINT32)&__samplerDesc);
+    if ((DD_HANDLE_UNVALID == adc_hdl) || (SARADC_SUCCESS != status)) {
+        if (SARADC_SUCCESS != status) {
+            ddev_close(adc_hdl);
+        }
+        GLOBAL_INT_RESTORE();
+        return false;
+    }
+    GLOBAL_INT_RESTORE();
+
+    tal_semaphore_wait(__doneSem, SAMPLER_CONV_TIMEOUT);
+
+    ddev_close(adc_hdl);
+    saradc_ensure_close();
+
+    if (__samplerDesc.all_done == 0) {
+        return false;
+    }
+
+    for (i = 0; i < __averaging; i++) {
+        sum += __conv[i];
+    }
+
+    // same scale as analogRead()
+    mv = (uint16_t)(saradc_calculate((UINT16)(sum / __averaging)) * 1000);
+    *value = (uint16_t)((uint32_t)mv * ADC_REGISTER_VAL_MAX / ADC_VOLTAGE_MAX);
+
+    return true;
+}
+
+void AnalogSampler::__store(const uint16_t *frame)
+{
+    size_t head = __head;
+    size_t next = (head + 1) % __ringFrames;
+
+    if (__blockCb != NULL) {
+        memcpy(&__block[__blockFill * __count], frame, __count * sizeof(uint16_t));
+        if (++__blockFill >= __blockFrames) {
+            __blockCb(__block, __blockFill, __count, __blockArg);
+            __blockFill = 0;
+        }
+        return;
+    }
+
+    if (next == __tail) {
+        __overruns++;
+        return;
+    }
+
+    memcpy(&__ring[head * __count], frame, __count * sizeof(uint16_t));
+    __asm__ __volatile__("" ::: "memory");
+    __head = next;
+}
+
+void AnalogSampler::__run(void)
+{
+    uint16_t frame[ANALOG_SAMPLER_MAX_CHANNELS];
+    uint16_t value = 0;
+    uint8_t i;
+
+    for (;;) {
+        tal_semaphore_wait(__scanSem, SEM_WAIT_FOREVER);
+        if (!__running) {
+            break;
+        }
+
+        for (i = 0; i < __count; i++) {
+            if (__convert(__chan[i], &value)) {
+                __last[i] = value;
+            }
+            frame[i] = __last[i];
+        }
+
+        if (__decimation > 1) {
+            for (i = 0; i < __count; i++) {
+                __decSum[i] += frame[i];
+            }
+            if (++__decFill >= __decimation) {
+                for (i = 0; i < __count; i++) {
+                    frame[i] = (uint16_t)(__decSum[i] / __decFill);
+                    __decSum[i] = 0;
+                }
+                __decFill = 0;
+                __store(frame);
+            }
+        } else {
+            __store(frame);
+        }
+
+        __scanPending = false;
+    }
+
+    tal_semaphore_post(__exitSem);
+}
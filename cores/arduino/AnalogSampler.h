@@ -0,0 +1,116 @@
+#ifndef __ANALOG_SAMPLER_H__
+#define __ANALOG_SAMPLER_H__
+
+#include "tal_thread.h"
+#include "tal_semaphore.h"
+
+#include "Arduino.h"
+
+#ifndef ANALOG_SAMPLER_MAX_CHANNELS
+#define ANALOG_SAMPLER_MAX_CHANNELS 5
+#endif
+
+// fastest scan rate, each pin of a scan is one saradc open, burst and close
+// on the sampler thread, which leaves no room for a shorter period
+#ifndef ANALOG_SAMPLER_MAX_RATE
+#define ANALOG_SAMPLER_MAX_RATE     2000
+#endif
+
+namespace arduino {
+
+/*
+ * Scans a list of analog pins at a fixed rate on the saradc continuous mode.
+ *
+ * Every scan converts each pin in turn and stores one frame (one value per
+ * pin, same order and scale as analogRead()) into a frame ring. Frames are
+ * either pulled with read() or handed out in blocks to onBlock(). Only one
+ * sampler can own the saradc at a time; while it runs analogRead() on a
+ * scanned pin returns the latest sampled value and on any other pin 0.
+ *
+ * Scans are paced by a 26MHz hardware timer (BK_TIMER_SAMPLER_ID, so tkl
+ * hardware timer 0 is not available). The period is
+ * rounded to whole us, periodUs() tells the one in use; a slot that comes
+ * while the previous scan still runs is skipped and counted in missedScans().
+ */
+class AnalogSampler
+{
+public:
+    typedef void (*BlockCallback)(const uint16_t *frames, size_t frameCount, uint8_t channels, void *arg);
+
+    AnalogSampler();
+    ~AnalogSampler();
+
+    // frames: ring capacity in frames
+    bool begin(const pin_size_t *pins, uint8_t count, uint32_t rateHz, size_t frames = 64);
+    // does nothing from the block callback, which runs on the sampler thread
+    void end(void);
+
+    // conversions averaged into one sample, done inside one saradc burst (1..255)
+    void setAveraging(uint8_t conversions);
+    // frames averaged into one stored frame (1 = off)
+    void setDecimation(uint8_t factor);
+    // deliver frames in blocks from the sampler thread instead of the ring,
+    // must be called before begin()
+    void onBlock(BlockCallback cb, size_t framesPerBlock, void *arg = NULL);
+
+    // frames waiting in the ring
+    size_t available(void);
+    // copy up to maxFrames interleaved frames, return frames copied
+    size_t read(uint16_t *frames, size_t maxFrames);
+
+    uint8_t channels(void) { return __count; }
+    // scan period in use, 1000000 / rateHz rounded
+    uint32_t periodUs(void) { return __periodUs; }
+    // frames dropped because the ring was full
+    uint32_t overruns(void) { return __overruns; }
+    // scans that started later than their slot
+    uint32_t missedScans(void) { return __missed; }
+    void resetCounters(void) { __overruns = 0; __missed = 0; }
+
+    // sampler thread body, saradc and timer isr hooks
+    void __run(void);
+    void __convDone(void);
+    void __slot(void);
+    bool __latest(int channel, int *value);
+private:
+    bool __convert(uint8_t channel, uint16_t *value);
+    void __store(const uint16_t *frame);
+
+    uint8_t __count = 0;
+    uint8_t __chan[ANALOG_SAMPLER_MAX_CHANNELS];
+    volatile uint16_t __last[ANALOG_SAMPLER_MAX_CHANNELS];
+    uint32_t __periodUs = 0;
+    // set by the timer isr, cleared once the scan is done
+    volatile bool __scanPending = false;
+
+    uint8_t __averaging = 1;
+    uint8_t __decimation = 1;
+    uint8_t __decFill = 0;
+    uint32_t __decSum[ANALOG_SAMPLER_MAX_CHANNELS];
+    uint16_t *__conv = NULL;
+
+    // frame ring, the sampler thread produces and read() consumes
+    uint16_t *__ring = NULL;
+    size_t __ringFrames = 0;
+    volatile size_t __head = 0;
+    volatile size_t __tail = 0;
+
+    BlockCallback __blockCb = NULL;
+    void *__blockArg = NULL;
+    size_t __blockFrames = 0;
+    size_t __blockFill = 0;
+    uint16_t *__block = NULL;
+
+    volatile uint32_t __overruns = 0;
+    volatile uint32_t __missed = 0;
+
+    volatile bool __running = false;
+    THREAD_HANDLE __task = NULL;
+    SEM_HANDLE __doneSem = NULL;
+    SEM_HANDLE __scanSem = NULL;
+    SEM_HANDLE __exitSem = NULL;
+};
+
+}
+
+#endif // __ANALOG_SAMPLER_H__
@@ -13,6 +13,66 @@ extern "C"{
 
 void tuya_app_main(void);
 
+// micros() without the 32 bit wrap
+uint64_t micros64(void);
+
+typedef enum {
+    LOOP_MODE_TICK = 0,     // sleep one rtos tick after every loop() (default)
+    LOOP_MODE_FREE_RUN,     // only yield, tasks below the arduino thread priority starve until loop() blocks
+    LOOP_MODE_FIXED_RATE,   // start loop() every periodMs, late starts are skipped not made up
+    LOOP_MODE_EVENT,        // wait for loopSignal(), serial rx, or periodMs if it is not 0
+} LoopMode;
+
+typedef struct {
+    uint32_t iterations;
+    uint32_t minPeriodUs;   // time between two loop() starts
+    uint32_t avgPeriodUs;
+    uint32_t maxPeriodUs;
+    uint32_t jitterUs;      // mean change between consecutive periods
+    uint32_t overruns;      // fixed rate: loop() took longer than the period
+} LoopStats;
+
+void setLoopMode(LoopMode mode, uint32_t periodMs);
+LoopMode getLoopMode(void);
+// wake an event driven loop, safe from interrupts and other tasks
+void loopSignal(void);
+void getLoopStats(LoopStats *stats);
+void resetLoopStats(void);
+
+// percent of cpu time spent outside the idle task over the last second, or
+// the last 10 seconds; sampled from before setup()
+float getCpuLoad(bool tenSeconds = false);
+
+typedef struct {
+    uint32_t count;         // callbacks run
+    uint32_t missed;        // deferred edges dropped because the queue was full
+    uint32_t coalesced;     // deferred edges folded into an event of the same pin still queued
+    uint32_t lastLatencyUs; // deferred: isr to callback start
+    uint32_t maxLatencyUs;
+} InterruptStats;
+
+// the callback runs in the high priority dispatcher task instead of the gpio isr
+void attachInterruptDeferred(pin_size_t interruptNumber, voidFuncPtr callback, PinStatus mode);
+void attachInterruptParamDeferred(pin_size_t interruptNumber, voidFuncPtrParam callback, PinStatus mode, void* param);
+void getInterruptStats(pin_size_t interruptNumber, InterruptStats *stats);
+void resetInterruptStats(pin_size_t interruptNumber);
+
+// fast gpio, the pin has to be set up with pinMode() first
+void digitalWriteFast(pin_size_t pinNumber, PinStatus status);
+PinStatus digitalReadFast(pin_size_t pinNumber);
+// set the output level of every pin in mask (bit n = pin n) at once
+void portWrite(uint32_t mask, uint32_t value);
+
+// pwm period for analogWrite(), applied to running channels too (default 1000 Hz)
+void analogWriteFrequency(uint32_t frequency);
+// analogWrite() full scale becomes 2^bits - 1, values are 0-100 until this is called
+void analogWriteResolution(uint8_t bits);
+// set several pwm pins at once, the new duties take effect on the same period boundary
+void analogWriteGroup(const pin_size_t *pins, const int *values, uint8_t count);
+
+// shift a whole buffer out, data p16 + clock p14 go through the spi dma engine
+void shiftOutBuffer(pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOrder, const uint8_t *buf, size_t len);
+
 #if (defined(__cplusplus)||defined(c_plusplus))
 }
 #endif
@@ -20,6 +80,8 @@ void tuya_app_main(void);
 using namespace arduino;
 
 #include "SerialUART.h"
+#include "AnalogSampler.h"
+#include "Arena.h"
 
 #define Serial _SerialUART0_
 
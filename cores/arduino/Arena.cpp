@@ -0,0 +1,148 @@
+#include "Arduino.h"
+#include "Arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace arduino;
+
+Arena::Arena(size_t blockSize)
+    : __blockSize(blockSize)
+{
+}
+
+Arena::Arena(void *buffer, size_t size, size_t blockSize)
+    : __blockSize(blockSize)
+{
+    __first = (uint8_t *)buffer;
+    __firstSize = size;
+    __pos = __first;
+    __end = __first + size;
+}
+
+Arena::~Arena()
+{
+    release();
+}
+
+bool Arena::__grow(size_t size)
+{
+    Block *block = NULL;
+
+    if (size < __blockSize) {
+        size = __blockSize;
+    }
+
+    if (__first == NULL) {
+        __first = (uint8_t *)malloc(size);
+        if (__first == NULL) {
+            return false;
+        }
+        __firstSize = size;
+        __firstOwned = true;
+        __pos = __first;
+        __end = __first + size;
+        return true;
+    }
+
+    // what is left of the current block stays unused until reset()
+    block = (Block *)malloc(sizeof(Block) + size);
+    if (block == NULL) {
+        return false;
+    }
+    block->next = __blocks;
+    block->size = size;
+    __blocks = block;
+    __overflows++;
+
+    __pos = (uint8_t *)(block + 1);
+    __end = __pos + size;
+
+    return true;
+}
+
+void *Arena::alloc(size_t size, size_t align)
+{
+    uintptr_t pos = 0;
+
+    if (align == 0 || (align & (align - 1)) != 0) {
+        return NULL;
+    }
+
+    pos = ((uintptr_t)__pos + align - 1) & ~(uintptr_t)(align - 1);
+    if (__pos == NULL || pos > (uintptr_t)__end || size > (uintptr_t)__end - pos) {
+        // a fresh block is 8 byte aligned, larger alignments may need the slack
+        if (size > SIZE_MAX - align || !__grow(size + align)) {
+            return NULL;
+        }
+        pos = ((uintptr_t)__pos + align - 1) & ~(uintptr_t)(align - 1);
+    }
+
+    __used += pos + size - (uintptr_t)__pos;
+    if (__used > __peak) {
+        __peak = __used;
+    }
+    __pos = (uint8_t *)(pos + size);
+
+    return (void *)pos;
+}
+
+char *Arena::strndup(const char *str, size_t len)
+{
+    char *copy = NULL;
+    size_t n = 0;
+
+    if (str == NULL) {
+        return NULL;
+    }
+
+    while (n < len && str[n] != '\0') {
+        n++;
+    }
+    len = n;
+    copy = (char *)alloc(len + 1, 1);
+    if (copy != NULL) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+
+    return copy;
+}
+
+char *Arena::strdup(const char *str)
+{
+    return strndup(str, SIZE_MAX);
+}
+
+void Arena::reset(void)
+{
+    Block *block = NULL;
+
+    while (__blocks != NULL) {
+        block = __blocks;
+        __blocks = block->next;
+        free(block);
+    }
+
+    __pos = __first;
+    __end = (__first != NULL) ? __first + __firstSize : NULL;
+    __used = 0;
+
+    return;
+}
+
+void Arena::release(void)
+{
+    reset();
+
+    if (__firstOwned) {
+        free(__first);
+        __first = NULL;
+        __firstSize = 0;
+        __firstOwned = false;
+        __pos = NULL;
+        __end = NULL;
+    }
+
+    return;
+}
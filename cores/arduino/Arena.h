@@ -0,0 +1,81 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace arduino {
+
+/*
+ * Bump allocator for work with a clear end, e.g. parsing one message.
+ *
+ * alloc() hands out memory from a block by moving a pointer and there is no
+ * per allocation free; reset() gives everything back at once and keeps the
+ * first block for the next round. The first block is either a buffer given
+ * to the constructor or taken from the heap on the first alloc(). When it is
+ * full further blocks are taken from the heap and freed again by reset(), so
+ * a first block big enough for the usual case makes reset() O(1).
+ *
+ * Destructors of objects placed in the arena are not run. Not thread safe.
+ */
+class Arena
+{
+public:
+    // blockSize: size of the heap blocks, a larger alloc() gets a block of its own
+    explicit Arena(size_t blockSize = 1024);
+    // buffer is the first block, it stays owned by the caller
+    Arena(void *buffer, size_t size, size_t blockSize = 1024);
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // align must be a power of 2, NULL when the heap is out of memory
+    void *alloc(size_t size, size_t align = 8);
+    // uninitialised room for count T
+    template <typename T> T *allocate(size_t count = 1)
+    {
+        return (T *)alloc(sizeof(T) * count, alignof(T));
+    }
+    char *strdup(const char *str);
+    char *strndup(const char *str, size_t len);
+
+    // everything handed out is gone
+    void reset(void);
+    // like reset(), and the first block goes back to the heap too
+    void release(void);
+
+    // bytes handed out since the last reset(), alignment included
+    size_t used(void) { return __used; }
+    // most bytes handed out between two resets
+    size_t peak(void) { return __peak; }
+    // extra heap blocks taken since construction, a hint that the first block is too small
+    uint32_t overflows(void) { return __overflows; }
+
+private:
+    struct Block {
+        Block *next;
+        size_t size;
+    };
+
+    bool __grow(size_t size);
+
+    size_t __blockSize;
+    // first block, reused after reset()
+    uint8_t *__first = NULL;
+    size_t __firstSize = 0;
+    bool __firstOwned = false;
+    // blocks taken after the first one, newest first
+    Block *__blocks = NULL;
+
+    uint8_t *__pos = NULL;
+    uint8_t *__end = NULL;
+
+    size_t __used = 0;
+    size_t __peak = 0;
+    uint32_t __overflows = 0;
+};
+
+}
+
+#endif // __ARENA_H__
@@ -1,33 +1,179 @@
 #include "Arduino.h"
 
 #include "tkl_gpio.h"
+#include "tal_thread.h"
+#include "tal_semaphore.h"
 
-void attachInterrupt(pin_size_t interruptNumber, voidFuncPtr callback, PinStatus mode)
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define INTERRUPT_PIN_MAX       32
+
+#ifndef INTERRUPT_QUEUE_SIZE
+#define INTERRUPT_QUEUE_SIZE    32
+#endif
+
+typedef struct {
+    voidFuncPtr callback;
+    voidFuncPtrParam callbackParam;
+    void *param;
+    bool deferred;
+    bool level;
+    InterruptStats stats;
+} __irq_pin_t;
+
+typedef struct {
+    uint8_t pin;
+    uint32_t stamp;
+} __irq_event_t;
+
+static __irq_pin_t __irqPin[INTERRUPT_PIN_MAX];
+
+// deferred events, the gpio isr produces and the dispatcher task consumes
+static __irq_event_t __irqQueue[INTERRUPT_QUEUE_SIZE];
+static volatile uint32_t __irqHead = 0;
+static volatile uint32_t __irqTail = 0;
+// events of each pin still waiting in the queue
+static volatile uint8_t __irqPending[INTERRUPT_PIN_MAX];
+
+static THREAD_HANDLE __irqThread = NULL;
+static SEM_HANDLE __irqSem = NULL;
+
+static void __irqRun(__irq_pin_t *entry)
 {
-    TUYA_GPIO_IRQ_T irqConfig;
-    irqConfig.cb = (TUYA_GPIO_IRQ_CB)callback;
-    irqConfig.arg = NULL;
+    if (entry->callbackParam != NULL) {
+        entry->callbackParam(entry->param);
+    } else if (entry->callback != NULL) {
+        entry->callback();
+    }
 
-    switch (mode) {
-        case FALLING:
-            irqConfig.mode = TUYA_GPIO_IRQ_FALL;
-        break;
-        case RISING:
-            irqConfig.mode = TUYA_GPIO_IRQ_RISE;
-        break;
-        default : return;
+    return;
+}
+
+static void __irqPush(uint8_t pin)
+{
+    __irq_pin_t *entry = &__irqPin[pin];
+    uint32_t head = __irqHead;
+    uint32_t next = (head + 1) % INTERRUPT_QUEUE_SIZE;
+
+    if (__irqPending[pin]) {
+        // a queued event of this pin still runs the callback, the edge is folded into it
+        entry->stats.coalesced++;
+    } else if (next == __irqTail) {
+        // nothing will run for this pin, so a level is left unmasked to fire again
+        entry->stats.missed++;
+        return;
+    } else {
+        __irqQueue[head].pin = pin;
+        __irqQueue[head].stamp = (uint32_t)micros();
+        __asm__ __volatile__("" ::: "memory");
+        __irqHead = next;
+        __irqPending[pin]++;
     }
 
-    tkl_gpio_irq_init((TUYA_GPIO_NUM_E)interruptNumber, &irqConfig);
-    tkl_gpio_irq_enable((TUYA_GPIO_NUM_E)interruptNumber);
+    // a level keeps firing until the dispatcher has run the callback
+    if (entry->level) {
+        tkl_gpio_irq_disable((TUYA_GPIO_NUM_E)pin);
+    }
+
+    tal_semaphore_post(__irqSem);
 
     return;
 }
-void attachInterruptParam(pin_size_t interruptNumber, voidFuncPtrParam callback, PinStatus mode, void* param)
+
+static void __irqIsr(void *arg)
+{
+    uint8_t pin = (uint8_t)(uintptr_t)arg;
+    __irq_pin_t *entry = &__irqPin[pin];
+
+    if (entry->deferred) {
+        __irqPush(pin);
+        return;
+    }
+
+    entry->stats.count++;
+    __irqRun(entry);
+
+    loopSignal();
+
+    return;
+}
+
+static void __irqDispatch(void *arg)
+{
+    __irq_event_t event;
+    __irq_pin_t *entry = NULL;
+    uint32_t tail = 0;
+    uint32_t latency = 0;
+
+    for (;;) {
+        tal_semaphore_wait(__irqSem, SEM_WAIT_FOREVER);
+
+        tail = __irqTail;
+        while (tail != __irqHead) {
+            event = __irqQueue[tail];
+            tail = (tail + 1) % INTERRUPT_QUEUE_SIZE;
+            __asm__ __volatile__("" ::: "memory");
+            __irqTail = tail;
+
+            portENTER_CRITICAL();
+            __irqPending[event.pin]--;
+            portEXIT_CRITICAL();
+
+            entry = &__irqPin[event.pin];
+            if (!entry->deferred) {
+                // detached or switched to direct while queued
+                continue;
+            }
+
+            latency = (uint32_t)micros() - event.stamp;
+            entry->stats.lastLatencyUs = latency;
+            if (latency > entry->stats.maxLatencyUs) {
+                entry->stats.maxLatencyUs = latency;
+            }
+            entry->stats.count++;
+
+            __irqRun(entry);
+
+            if (entry->level) {
+                tkl_gpio_irq_enable((TUYA_GPIO_NUM_E)event.pin);
+            }
+        }
+
+        loopSignal();
+    }
+
+    return;
+}
+
+static bool __irqDispatcherBegin(void)
+{
+    if (__irqThread != NULL) {
+        return true;
+    }
+
+    if (__irqSem == NULL && OPRT_OK != tal_semaphore_create_init(&__irqSem, 0, 1)) {
+        return false;
+    }
+
+    THREAD_CFG_T thrd_param = {4096, THREAD_PRIO_0, (CHAR_T *)"arduino_irq"};
+    if (OPRT_OK != tal_thread_create_and_start(&__irqThread, NULL, NULL, __irqDispatch, NULL, &thrd_param)) {
+        __irqThread = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+static void __attach(pin_size_t interruptNumber, voidFuncPtr callback, voidFuncPtrParam callbackParam,
+                     void *param, PinStatus mode, bool deferred)
 {
     TUYA_GPIO_IRQ_T irqConfig;
-    irqConfig.cb = (TUYA_GPIO_IRQ_CB)callback;
-    irqConfig.arg = param;
+    __irq_pin_t *entry = NULL;
+
+    if (interruptNumber >= INTERRUPT_PIN_MAX) {
+        return;
+    }
 
     switch (mode) {
         case FALLING:
@@ -36,17 +182,103 @@ void attachInterruptParam(pin_size_t interruptNumber, voidFuncPtrParam callback,
         case RISING:
             irqConfig.mode = TUYA_GPIO_IRQ_RISE;
         break;
+        case CHANGE:
+            irqConfig.mode = TUYA_GPIO_IRQ_RISE_FALL;
+        break;
+        case LOW:
+            irqConfig.mode = TUYA_GPIO_IRQ_LOW;
+        break;
+        case HIGH:
+            irqConfig.mode = TUYA_GPIO_IRQ_HIGH;
+        break;
         default : return;
     }
 
+    if (deferred && !__irqDispatcherBegin()) {
+        return;
+    }
+
+    tkl_gpio_irq_disable((TUYA_GPIO_NUM_E)interruptNumber);
+
+    entry = &__irqPin[interruptNumber];
+    entry->callback = callback;
+    entry->callbackParam = callbackParam;
+    entry->param = param;
+    entry->deferred = deferred;
+    entry->level = (mode == LOW) || (mode == HIGH);
+
+    irqConfig.cb = __irqIsr;
+    irqConfig.arg = (void *)(uintptr_t)interruptNumber;
+
     tkl_gpio_irq_init((TUYA_GPIO_NUM_E)interruptNumber, &irqConfig);
     tkl_gpio_irq_enable((TUYA_GPIO_NUM_E)interruptNumber);
 
     return;
 }
+
+void attachInterrupt(pin_size_t interruptNumber, voidFuncPtr callback, PinStatus mode)
+{
+    __attach(interruptNumber, callback, NULL, NULL, mode, false);
+
+    return;
+}
+
+void attachInterruptParam(pin_size_t interruptNumber, voidFuncPtrParam callback, PinStatus mode, void* param)
+{
+    __attach(interruptNumber, NULL, callback, param, mode, false);
+
+    return;
+}
+
+void attachInterruptDeferred(pin_size_t interruptNumber, voidFuncPtr callback, PinStatus mode)
+{
+    __attach(interruptNumber, callback, NULL, NULL, mode, true);
+
+    return;
+}
+
+void attachInterruptParamDeferred(pin_size_t interruptNumber, voidFuncPtrParam callback, PinStatus mode, void* param)
+{
+    __attach(interruptNumber, NULL, callback, param, mode, true);
+
+    return;
+}
+
 void detachInterrupt(pin_size_t interruptNumber)
 {
     tkl_gpio_irq_disable((TUYA_GPIO_NUM_E)interruptNumber);
 
+    if (interruptNumber < INTERRUPT_PIN_MAX) {
+        __irqPin[interruptNumber].deferred = false;
+        __irqPin[interruptNumber].callback = NULL;
+        __irqPin[interruptNumber].callbackParam = NULL;
+    }
+
+    return;
+}
+
+void getInterruptStats(pin_size_t interruptNumber, InterruptStats *stats)
+{
+    if (interruptNumber >= INTERRUPT_PIN_MAX || stats == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL();
+    *stats = __irqPin[interruptNumber].stats;
+    portEXIT_CRITICAL();
+
+    return;
+}
+
+void resetInterruptStats(pin_size_t interruptNumber)
+{
+    if (interruptNumber >= INTERRUPT_PIN_MAX) {
+        return;
+    }
+
+    portENTER_CRITICAL();
+    memset(&__irqPin[interruptNumber].stats, 0, sizeof(InterruptStats));
+    portEXIT_CRITICAL();
+
     return;
 }
@@ -0,0 +1,383 @@
+#include "Arduino.h"
+#include "SPI.h"
+
+// vendor driver headers have no c++ guards
+extern "C" {
+#include "drv_model_pub.h"
+#include "spi_pub.h"
+}
+
+using namespace arduino;
+
+static void __spi_task(void *arg)
+{
+    ((SPIMaster *)arg)->__run();
+}
+
+SPIMaster::SPIMaster()
+{
+}
+
+SPIMaster::~SPIMaster()
+{
+}
+
+void SPIMaster::begin()
+{
+    if (__started) {
+        return;
+    }
+
+    // after end() the spi task still waits on __jobSem, keep its handles
+    if (__task == NULL) {
+        if (OPRT_OK != tal_mutex_create_init(&__busMutex) ||
+            OPRT_OK != tal_mutex_create_init(&__queueMutex) ||
+            OPRT_OK != tal_semaphore_create_init(&__jobSem, 0, 1) ||
+            OPRT_OK != tal_semaphore_create_init(&__doneSem, 0, 1)) {
+            end();
+            return;
+        }
+        __head = 0;
+        __tail = 0;
+    }
+
+    __started = true;
+
+    return;
+}
+
+void SPIMaster::end()
+{
+    // __busMutex is held until endTransaction(), the flush and deinit below would wait on it
+    if (__inTransaction) {
+        return;
+    }
+
+    if (__started) {
+        flush();
+        __started = false;
+    }
+
+    if (__configured) {
+        tal_mutex_lock(__busMutex);
+        bk_spi_master_deinit();
+        __configured = false;
+        tal_mutex_unlock(__busMutex);
+    }
+
+    // the spi task keeps waiting on __jobSem, so it and its semaphores stay for the next begin()
+    if (__task == NULL) {
+        if (__jobSem != NULL) {
+            tal_semaphore_release(__jobSem);
+            __jobSem = NULL;
+        }
+        if (__doneSem != NULL) {
+            tal_semaphore_release(__doneSem);
+            __doneSem = NULL;
+        }
+        if (__queueMutex != NULL) {
+            tal_mutex_release(__queueMutex);
+            __queueMutex = NULL;
+        }
+        if (__busMutex != NULL) {
+            tal_mutex_release(__busMutex);
+            __busMutex = NULL;
+        }
+    }
+
+    return;
+}
+
+// only what changed is written, the dma engine is set up once
+bool SPIMaster::__apply(const SPISettings &settings)
+{
+    UINT32 clock = settings.getClockFreq();
+    UINT8 cpol = (settings.getDataMode() == SPI_MODE2 || settings.getDataMode() == SPI_MODE3) ? 1 : 0;
+    UINT8 cpha = (settings.getDataMode() == SPI_MODE1 || settings.getDataMode() == SPI_MODE3) ? 1 : 0;
+    UINT8 lsb = (settings.getBitOrder() == LSBFIRST) ? 1 : 0;
+
+    if (!__configured) {
+        if (0 != bk_spi_master_dma_init((cpol ? BK_SPI_CPOL : 0) | (cpha ? BK_SPI_CPHA : 0), clock, 0)) {
+            return false;
+        }
+        sddev_control(SPI_DEV_NAME, CMD_SPI_LSB_EN, &lsb);
+        __current = settings;
+        __configured = true;
+        return true;
+    }
+
+    if (settings == __current) {
+        return true;
+    }
+
+    if (settings.getClockFreq() != __current.getClockFreq()) {
+        sddev_control(SPI_DEV_NAME, CMD_SPI_SET_CKR, &clock);
+    }
+    if (settings.getDataMode() != __current.getDataMode()) {
+        sddev_control(SPI_DEV_NAME, CMD_SPI_SET_CKPOL, &cpol);
+        sddev_control(SPI_DEV_NAME, CMD_SPI_SET_CKPHA, &cpha);
+    }
+    if (settings.getBitOrder() != __current.getBitOrder()) {
+        sddev_control(SPI_DEV_NAME, CMD_SPI_LSB_EN, &lsb);
+    }
+    __current = settings;
+
+    return true;
+}
+
+// the caller holds __busMutex
+int SPIMaster::__xfer(const void *txBuf, void *rxBuf, size_t count)
+{
+    struct spi_message msg;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    msg.send_buf = (UINT8 *)txBuf;
+    msg.send_len = (txBuf != NULL) ? count : 0;
+    msg.recv_buf = (UINT8 *)rxBuf;
+    msg.recv_len = (rxBuf != NULL) ? count : 0;
+
+    // send only goes through the chunked tx path, it does not wait on rx dma
+    if (rxBuf == NULL) {
+        return bk_spi_master_dma_send(&msg);
+    }
+
+    return bk_spi_master_dma_xfer(&msg);
+}
+
+void SPIMaster::beginTransaction(SPISettings settings)
+{
+    if (!__started) {
+        return;
+    }
+
+    // keeps queued transactions off the bus until endTransaction()
+    tal_mutex_lock(__busMutex);
+    __inTransaction = true;
+    __settings = settings;
+    __apply(__settings);
+
+    return;
+}
+
+void SPIMaster::endTransaction(void)
+{
+    if (!__started || !__inTransaction) {
+        return;
+    }
+
+    __inTransaction = false;
+    tal_mutex_unlock(__busMutex);
+
+    return;
+}
+
+void SPIMaster::transfer(const void *txBuf, void *rxBuf, size_t count)
+{
+    bool locked = false;
+
+    if (!__started || count == 0) {
+        return;
+    }
+
+    // the mutex is not recursive, inside a transaction it is already held
+    if (!__inTransaction) {
+        tal_mutex_lock(__busMutex);
+        locked = true;
+    }
+    if (__apply(__settings)) {
+        __xfer(txBuf, rxBuf, count);
+    }
+    if (locked) {
+        tal_mutex_unlock(__busMutex);
+    }
+
+    return;
+}
+
+uint8_t SPIMaster::transfer(uint8_t data)
+{
+    uint8_t rx = 0;
+
+    transfer(&data, &rx, 1);
+
+    return rx;
+}
+
+uint16_t SPIMaster::transfer16(uint16_t data)
+{
+    uint8_t tx[2];
+    uint8_t rx[2] = {0, 0};
+
+    if (__settings.getBitOrder() == LSBFIRST) {
+        tx[0] = data & 0xFF;
+        tx[1] = data >> 8;
+        transfer(tx, rx, 2);
+        return (uint16_t)(rx[1] << 8) | rx[0];
+    }
+
+    tx[0] = data >> 8;
+    tx[1] = data & 0xFF;
+    transfer(tx, rx, 2);
+
+    return (uint16_t)(rx[0] << 8) | rx[1];
+}
+
+void SPIMaster::transfer(void *buf, size_t count)
+{
+    transfer(buf, buf, count);
+
+    return;
+}
+
+void SPIMaster::writeBytes(const uint8_t *data, size_t count)
+{
+    transfer(data, NULL, count);
+
+    return;
+}
+
+bool SPIMaster::__enqueue(const __job_t &job)
+{
+    size_t next;
+
+    if (!__started) {
+        return false;
+    }
+
+    if (__task == NULL) {
+        THREAD_CFG_T thrd_param = {2048, THREAD_PRIO_1, (CHAR_T *)"arduino_spi"};
+        if (OPRT_OK != tal_thread_create_and_start(&__task, NULL, NULL, __spi_task, this, &thrd_param)) {
+            __task = NULL;
+            return false;
+        }
+    }
+
+    tal_mutex_lock(__queueMutex);
+    next = (__head + 1) % SPI_QUEUE_SIZE;
+    if (next == __tail) {
+        tal_mutex_unlock(__queueMutex);
+        return false;
+    }
+    __jobs[__head] = job;
+    if (job.segments == &job.single) {
+        __jobs[__head].segments = &__jobs[__head].single;
+    }
+    __head = next;
+    tal_mutex_unlock(__queueMutex);
+
+    tal_semaphore_post(__jobSem);
+
+    return true;
+}
+
+bool SPIMaster::transferAsync(const void *txBuf, void *rxBuf, size_t count, TransferCallback cb, void *arg)
+{
+    __job_t job;
+
+    if (count == 0 || (txBuf == NULL && rxBuf == NULL)) {
+        return false;
+    }
+
+    job.single.tx = txBuf;
+    job.single.rx = rxBuf;
+    job.single.len = count;
+    job.segments = &job.single;
+    job.count = 1;
+    job.cs = SPI_CS_NONE;
+    job.settings = __settings;
+    job.cb = cb;
+    job.arg = arg;
+
+    return __enqueue(job);
+}
+
+bool SPIMaster::transferAsync(const SPITransfer *segments, size_t count, pin_size_t csPin, TransferCallback cb, void *arg)
+{
+    __job_t job;
+
+    if (segments == NULL || count == 0) {
+        return false;
+    }
+
+    job.single.tx = NULL;
+    job.single.rx = NULL;
+    job.single.len = 0;
+    job.segments = segments;
+    job.count = count;
+    job.cs = (csPin == SPI_CS_NONE) ? SPI_CS_NONE : (uint8_t)csPin;
+    job.settings = __settings;
+    job.cb = cb;
+    job.arg = arg;
+
+    return __enqueue(job);
+}
+
+size_t SPIMaster::pending(void)
+{
+    size_t head = __head;
+    size_t tail = __tail;
+
+    return ((head >= tail) ? (head - tail) : (SPI_QUEUE_SIZE - tail + head)) + (__active ? 1 : 0);
+}
+
+void SPIMaster::flush(void)
+{
+    // the spi task cannot take the bus before endTransaction()
+    if (__inTransaction) {
+        return;
+    }
+
+    while (__task != NULL && pending() > 0) {
+        tal_semaphore_wait(__doneSem, 10);
+    }
+
+    return;
+}
+
+void SPIMaster::__run(void)
+{
+    __job_t *job = NULL;
+    size_t i;
+    int status;
+
+    for (;;) {
+        tal_semaphore_wait(__jobSem, SEM_WAIT_FOREVER);
+
+        while (__tail != __head) {
+            job = &__jobs[__tail];
+            __active = true;
+            status = 0;
+
+            tal_mutex_lock(__busMutex);
+            if (!__apply(job->settings)) {
+                status = -1;
+            } else {
+                if (job->cs != SPI_CS_NONE) {
+                    digitalWrite(job->cs, LOW);
+                }
+                for (i = 0; i < job->count && status == 0; i++) {
+                    status = __xfer(job->segments[i].tx, job->segments[i].rx, job->segments[i].len);
+                }
+                if (job->cs != SPI_CS_NONE) {
+                    digitalWrite(job->cs, HIGH);
+                }
+            }
+            tal_mutex_unlock(__busMutex);
+
+            if (job->cb != NULL) {
+                job->cb((status == 0) ? 0 : -1, job->arg);
+            }
+
+            __tail = (__tail + 1) % SPI_QUEUE_SIZE;
+            __active = false;
+            tal_semaphore_post(__doneSem);
+        }
+    }
+
+    return;
+}
+
+SPIMaster _SPIMaster0_;
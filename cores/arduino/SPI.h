@@ -0,0 +1,116 @@
+#ifndef __SPI_MASTER_H__
+#define __SPI_MASTER_H__
+
+#include "tal_mutex.h"
+#include "tal_semaphore.h"
+#include "tal_thread.h"
+
+#include "Arduino.h"
+#include "api/HardwareSPI.h"
+
+// spi master pins, the spi engine runs in 3-line mode and chip select is a gpio
+#define SPI_SCK_PIN     p14
+#define SPI_MOSI_PIN    p16
+#define SPI_MISO_PIN    p17
+
+// no chip select, the caller drives it
+#define SPI_CS_NONE     0xFF
+
+#ifndef SPI_QUEUE_SIZE
+#define SPI_QUEUE_SIZE  8
+#endif
+
+namespace arduino {
+
+// one buffer of a queued transaction, tx or rx may be NULL
+typedef struct {
+    const void *tx;
+    void *rx;
+    size_t len;
+} SPITransfer;
+
+class SPIMaster : public HardwareSPI
+{
+public:
+    // status is 0 when every segment went out, -1 otherwise
+    typedef void (*TransferCallback)(int status, void *arg);
+
+    SPIMaster();
+    ~SPIMaster();
+
+    uint8_t transfer(uint8_t data);
+    uint16_t transfer16(uint16_t data);
+    void transfer(void *buf, size_t count);
+    // full duplex with separate buffers, either may be NULL
+    void transfer(const void *txBuf, void *rxBuf, size_t count);
+    void writeBytes(const uint8_t *data, size_t count);
+
+    // Transaction Functions
+    void usingInterrupt(int interruptNumber) {}
+    void notUsingInterrupt(int interruptNumber) {}
+    void beginTransaction(SPISettings settings);
+    void endTransaction(void);
+
+    // SPI Configuration methods
+    void attachInterrupt() {}
+    void detachInterrupt() {}
+
+    void begin();
+    // does nothing between beginTransaction() and endTransaction()
+    void end();
+
+    // Queue a single buffer, the callback runs from the spi task once it is out.
+    // The buffers must stay valid until then. Returns false if the queue is full.
+    bool transferAsync(const void *txBuf, void *rxBuf, size_t count,
+                       TransferCallback cb = NULL, void *arg = NULL);
+    // Queue several buffers sent back to back under one chip select assertion,
+    // the segment array must stay valid until the callback.
+    bool transferAsync(const SPITransfer *segments, size_t count, pin_size_t csPin,
+                       TransferCallback cb = NULL, void *arg = NULL);
+    // wait until every queued transaction is done, returns at once inside a transaction
+    void flush(void);
+    size_t pending(void);
+
+    // spi task body
+    void __run(void);
+private:
+    typedef struct {
+        SPITransfer single;
+        const SPITransfer *segments;
+        size_t count;
+        uint8_t cs;
+        SPISettings settings;
+        TransferCallback cb;
+        void *arg;
+    } __job_t;
+
+    bool __apply(const SPISettings &settings);
+    int __xfer(const void *txBuf, void *rxBuf, size_t count);
+    bool __enqueue(const __job_t &job);
+
+    bool __started = false;
+    bool __configured = false;
+    SPISettings __settings;
+    SPISettings __current;
+    // held around every use of the spi engine, and from beginTransaction() to endTransaction()
+    MUTEX_HANDLE __busMutex = NULL;
+    volatile bool __inTransaction = false;
+
+    // job ring, callers produce under __queueMutex and the spi task consumes
+    __job_t __jobs[SPI_QUEUE_SIZE];
+    volatile size_t __head = 0;
+    volatile size_t __tail = 0;
+    volatile bool __active = false;
+    MUTEX_HANDLE __queueMutex = NULL;
+    SEM_HANDLE __jobSem = NULL;
+    SEM_HANDLE __doneSem = NULL;
+    THREAD_HANDLE __task = NULL;
+};
+
+}
+
+extern arduino::SPIMaster _SPIMaster0_;
+
+#define SPI _SPIMaster0_
+
+#endif // __SPI_MASTER_H__
@@ -0,0 +1,205 @@
+#ifndef __SERIAL_RING_BUFFER_H__
+#define __SERIAL_RING_BUFFER_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// keep the compiler from moving buffer accesses across index updates
+#define __compilerBarrier() __asm__ __volatile__("" ::: "memory")
+
+namespace arduino {
+
+/*
+ * Single-producer/single-consumer byte ring.
+ *
+ * The producer only writes _head and the consumer only writes _tail, so one
+ * side may run in isr context and the other in a thread without any lock.
+ * One slot is kept empty to tell full from empty, begin(size) allocates
+ * size + 1 bytes so that size bytes can be stored.
+ */
+class SerialRingBuffer
+{
+public:
+    SerialRingBuffer() {}
+    ~SerialRingBuffer() { end(); }
+
+    bool begin(size_t size)
+    {
+        end();
+        _buffer = (uint8_t *)malloc(size + 1);
+        if (_buffer == NULL) {
+            return false;
+        }
+        _size = size + 1;
+        _head = 0;
+        _tail = 0;
+        return true;
+    }
+
+    void end(void)
+    {
+        uint8_t *p = _buffer;
+
+        _size = 0;
+        _buffer = NULL;
+        _head = 0;
+        _tail = 0;
+        if (p != NULL) {
+            free(p);
+        }
+    }
+
+    size_t capacity(void) const
+    {
+        return (_size > 0) ? (_size - 1) : 0;
+    }
+
+    size_t available(void) const
+    {
+        size_t head = _head;
+        size_t tail = _tail;
+
+        return (head >= tail) ? (head - tail) : (_size - tail + head);
+    }
+
+    size_t availableForStore(void) const
+    {
+        return (_size > 0) ? (_size - 1 - available()) : 0;
+    }
+
+    // producer side
+
+    // contiguous free span starting at head, fill it then call commit()
+    uint8_t *writeSpan(size_t *len)
+    {
+        size_t head = _head;
+        size_t tail = _tail;
+
+        if (_size == 0) {
+            *len = 0;
+            return NULL;
+        }
+
+        if (head >= tail) {
+            *len = _size - head - ((tail == 0) ? 1 : 0);
+        } else {
+            *len = tail - head - 1;
+        }
+
+        return &_buffer[head];
+    }
+
+    void commit(size_t n)
+    {
+        __compilerBarrier();
+        _head = (_head + n) % _size;
+    }
+
+    size_t store(const uint8_t *data, size_t len)
+    {
+        size_t stored = 0;
+        size_t n = 0;
+        uint8_t *p = NULL;
+
+        while (stored < len) {
+            p = writeSpan(&n);
+            if (n == 0) {
+                break;
+            }
+            if (n > len - stored) {
+                n = len - stored;
+            }
+            memcpy(p, data + stored, n);
+            commit(n);
+            stored += n;
+        }
+
+        return stored;
+    }
+
+    // consumer side
+
+    // contiguous filled span starting at tail, use it then call consume()
+    const uint8_t *readSpan(size_t *len) const
+    {
+        size_t head = _head;
+        size_t tail = _tail;
+
+        if (_size == 0) {
+            *len = 0;
+            return NULL;
+        }
+
+        *len = (head >= tail) ? (head - tail) : (_size - tail);
+
+        return &_buffer[tail];
+    }
+
+    void consume(size_t n)
+    {
+        __compilerBarrier();
+        _tail = (_tail + n) % _size;
+    }
+
+    size_t read(uint8_t *data, size_t len)
+    {
+        size_t done = 0;
+        size_t n = 0;
+        const uint8_t *p = NULL;
+
+        while (done < len) {
+            p = readSpan(&n);
+            if (n == 0) {
+                break;
+            }
+            if (n > len - done) {
+                n = len - done;
+            }
+            memcpy(data + done, p, n);
+            consume(n);
+            done += n;
+        }
+
+        return done;
+    }
+
+    int read_char(void)
+    {
+        uint8_t c = 0;
+
+        if (read(&c, 1) != 1) {
+            return -1;
+        }
+
+        return c;
+    }
+
+    int peek(void) const
+    {
+        size_t n = 0;
+        const uint8_t *p = readSpan(&n);
+
+        if (n == 0) {
+            return -1;
+        }
+
+        return *p;
+    }
+
+    // drop everything, consumer side only
+    void clear(void)
+    {
+        _tail = _head;
+    }
+
+private:
+    uint8_t *_buffer = NULL;
+    size_t _size = 0;
+    volatile size_t _head = 0;
+    volatile size_t _tail = 0;
+};
+
+}
+
+#endif // __SERIAL_RING_BUFFER_H__
@@ -26,9 +26,6 @@ SerialUART::~SerialUART()
 
 extern "C" void __uart_rx_cb(TUYA_UART_NUM_E port_id)
 {
-    uint8_t c = 0;
-    int rt = 0;
-
     // bk_printf("uart cb %d\r\n", port_id);
 
     if (__serialPtr[port_id] == NULL) {
@@ -36,16 +33,20 @@ extern "C" void __uart_rx_cb(TUYA_UART_NUM_E port_id)
         return;
     }
 
-    while (1) {
-        rt = tkl_uart_read(port_id, &c, 1);
-        if (rt != 1) {
-            // tkl_log_output("uart read error %d\r\n", rt);
-            break;
-        }
-        // bk_printf("- %c \r\n", c);
-        __serialPtr[port_id]->__rxBufWrite(c);
+    __serialPtr[port_id]->__rxBufFill();
+
+    return;
+}
+
+extern "C" void __uart_tx_cb(TUYA_UART_NUM_E port_id)
+{
+    if (__serialPtr[port_id] == NULL) {
+        tkl_uart_set_tx_int(port_id, FALSE);
+        return;
     }
 
+    __serialPtr[port_id]->__txBufDrain();
+
     return;
 }
 
@@ -57,9 +58,18 @@ void SerialUART::begin(unsigned long baudrate, uint16_t config)
         return;
     }
 
-    uartConfig.baudrate = baudrate;
+    if (__started) {
+        end();
+    }
 
-    __serialPtr[__uartID] = this;
+    if (!_rxBuffer.begin(__rxBufSize) || !_txBuffer.begin(__txBufSize)) {
+        _rxBuffer.end();
+        _txBuffer.end();
+        return;
+    }
+    __rxOverflow = 0;
+
+    uartConfig.baudrate = baudrate;
 
     // data bits
     switch (config & SERIAL_DATA_MASK) {
@@ -115,10 +125,16 @@ void SerialUART::begin(unsigned long baudrate, uint16_t config)
     // flowctrl
     uartConfig.flowctrl = TUYA_UART_FLOWCTRL_NONE;
 
+    tal_mutex_create_init(&__mutex);
+    tal_semaphore_create_init(&__txSem, 0, 1);
+    tal_semaphore_create_init(&__rxSem, 0, 1);
+
+    __serialPtr[__uartID] = this;
+    __started = true;
+
     tkl_uart_init(__uartID, &uartConfig);
     tkl_uart_rx_irq_cb_reg(__uartID, __uart_rx_cb);
-
-    tal_mutex_create_init(&__mutex);
+    tkl_uart_tx_irq_cb_reg(__uartID, __uart_tx_cb);
 
     return;
 }
@@ -131,75 +147,202 @@ void SerialUART::begin(unsigned long baudrate)
 
 void SerialUART::end()
 {
+    if (!__started) {
+        return;
+    }
+
+    flush();
+
+    tkl_uart_tx_irq_cb_reg(__uartID, NULL);
     tkl_uart_deinit(__uartID);
-    tal_mutex_release(&__mutex);
-    _rxBuffer.clear();
+    __serialPtr[__uartID] = NULL;
+    __started = false;
+
+    tal_mutex_release(__mutex);
+    __mutex = NULL;
+    tal_semaphore_release(__txSem);
+    __txSem = NULL;
+    tal_semaphore_release(__rxSem);
+    __rxSem = NULL;
+
+    _rxBuffer.end();
+    _txBuffer.end();
+
     return;
 }
 
-int SerialUART::__rxBufWrite(uint8_t c)
+size_t SerialUART::setRxBufferSize(size_t size)
 {
-    if (_rxBuffer.availableForStore()) {
-        _rxBuffer.store_char(c);
+    if (__started || size == 0) {
+        return 0;
     }
 
-    return 0;
+    __rxBufSize = size;
+
+    return size;
 }
 
-int SerialUART::available(void)
+size_t SerialUART::setTxBufferSize(size_t size)
+{
+    if (__started || size == 0) {
+        return 0;
+    }
+
+    __txBufSize = size;
+
+    return size;
+}
+
+void SerialUART::__rxBufFill(void)
 {
+    uint8_t *p = NULL;
+    uint8_t c = 0;
+    size_t len = 0;
     int rt = 0;
 
-    tal_mutex_lock(__mutex);
+    while (1) {
+        p = _rxBuffer.writeSpan(&len);
+        if (len == 0) {
+            // ring is full, the fifo still has to be drained
+            rt = tkl_uart_read(__uartID, &c, 1);
+            if (rt != 1) {
+                break;
+            }
+            __rxOverflow++;
+            continue;
+        }
+
+        rt = tkl_uart_read(__uartID, p, (len > 0xFFFF) ? 0xFFFF : len);
+        if (rt <= 0) {
+            break;
+        }
+        _rxBuffer.commit(rt);
+    }
 
-    rt = _rxBuffer.available();
+    tal_semaphore_post(__rxSem);
 
-    tal_mutex_unlock(__mutex);
+    // an event driven loop() wakes up on received data
+    loopSignal();
 
-    return rt;
+    return;
 }
 
-int SerialUART::peek(void)
+int SerialUART::available(void)
 {
-    int rt = 0;
+    return _rxBuffer.available();
+}
 
-    tal_mutex_lock(__mutex);
+int SerialUART::peek(void)
+{
+    return _rxBuffer.peek();
+}
 
-    rt = _rxBuffer.peek();
+int SerialUART::read(void)
+{
+    return _rxBuffer.read_char();
+}
 
-    tal_mutex_unlock(__mutex);
+size_t SerialUART::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    unsigned long waited = 0;
+
+    _startMillis = millis();
+    while (count < length) {
+        count += _rxBuffer.read((uint8_t *)buffer + count, length - count);
+        waited = millis() - _startMillis;
+        if (count >= length || !__started || waited >= _timeout) {
+            break;
+        }
+        // a post left from data read above only costs one more pass
+        tal_semaphore_wait(__rxSem, _timeout - waited);
+    }
 
-    return rt;
+    return count;
 }
 
-int SerialUART::read(void)
+void SerialUART::__txBufDrain(void)
 {
+    const uint8_t *p = NULL;
+    size_t len = 0;
     int rt = 0;
 
-    tal_mutex_lock(__mutex);
+    while (1) {
+        p = _txBuffer.readSpan(&len);
+        if (len == 0) {
+            break;
+        }
+        rt = tkl_uart_write(__uartID, const_cast<uint8_t*>(p), (len > 0xFFFF) ? 0xFFFF : len);
+        if (rt <= 0) {
+            // tx fifo is full, wait for the next interrupt
+            break;
+        }
+        _txBuffer.consume(rt);
+    }
+
+    if (_txBuffer.available() == 0) {
+        tkl_uart_set_tx_int(__uartID, FALSE);
+        // write() may have queued data after the check above
+        if (_txBuffer.available() != 0) {
+            tkl_uart_set_tx_int(__uartID, TRUE);
+        }
+    }
 
-    rt = _rxBuffer.read_char();
+    tal_semaphore_post(__txSem);
 
-    tal_mutex_unlock(__mutex);
+    return;
+}
 
-    return rt;
+int SerialUART::availableForWrite(void)
+{
+    return _txBuffer.availableForStore();
 }
 
 void SerialUART::flush(void)
 {
+    if (!__started) {
+        return;
+    }
+
+    while (_txBuffer.available() != 0) {
+        tkl_uart_set_tx_int(__uartID, TRUE);
+        tal_semaphore_wait(__txSem, 10);
+    }
+
+    tkl_uart_ioctl(__uartID, TUYA_UART_FLUSH_CMD, NULL);
+
     return;
 }
 
 size_t SerialUART::write(uint8_t c)
 {
-    return tkl_uart_write(__uartID, &c, 1);
+    return write(&c, 1);
 }
 
 size_t SerialUART::write(const uint8_t* c, size_t len)
 {
-    uint8_t *p = const_cast<uint8_t*>(c);
+    size_t sent = 0;
+
+    if (!__started) {
+        // not started, fall back to the blocking driver write
+        uint8_t *p = const_cast<uint8_t*>(c);
+        return tkl_uart_write(__uartID, p, len);
+    }
+
+    tal_mutex_lock(__mutex);
+
+    while (sent < len) {
+        sent += _txBuffer.store(c + sent, len - sent);
+        tkl_uart_set_tx_int(__uartID, TRUE);
+        if (sent < len) {
+            // ring is full, let the tx isr drain it
+            tal_semaphore_wait(__txSem, 10);
+        }
+    }
+
+    tal_mutex_unlock(__mutex);
 
-    return tkl_uart_write(__uartID, p, len);
+    return sent;
 }
 
 SerialUART::operator bool() {
@@ -3,10 +3,19 @@
 
 #include "tkl_uart.h"
 #include "tal_mutex.h"
+#include "tal_semaphore.h"
 
-#include "api/RingBuffer.h"
 #include "Arduino.h"
 #include "api/HardwareSerial.h"
+#include "SerialRingBuffer.h"
+
+#ifndef SERIAL_RX_BUFFER_SIZE
+#define SERIAL_RX_BUFFER_SIZE 256
+#endif
+
+#ifndef SERIAL_TX_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE 256
+#endif
 
 namespace arduino {
 
@@ -23,17 +32,43 @@ public:
     int peek(void);
     int read(void);
     void flush(void);
+    int availableForWrite(void);
     size_t write(uint8_t);
     size_t write(const uint8_t*, size_t);
     using Print::write; // pull in write(str) and write(buf, size) from Print
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
     operator bool();
 
+    // must be called before begin(), return the new size or 0 on failure
+    size_t setRxBufferSize(size_t size);
+    size_t setTxBufferSize(size_t size);
+
+    // bytes dropped because the rx ring was full
+    uint32_t rxOverflowCount(void) { return __rxOverflow; }
+    void resetRxOverflowCount(void) { __rxOverflow = 0; }
+
     // rx callback function
-    int __rxBufWrite(uint8_t c);
+    void __rxBufFill(void);
+    // tx fifo need write callback function
+    void __txBufDrain(void);
 private:
     TUYA_UART_NUM_E __uartID = UART_NUM_MAX;
-    MUTEX_HANDLE __mutex;
-    RingBufferN<256> _rxBuffer;
+    bool __started = false;
+
+    // rx ring, the rx isr is the only producer and the sketch the only consumer
+    SerialRingBuffer _rxBuffer;
+    size_t __rxBufSize = SERIAL_RX_BUFFER_SIZE;
+    volatile uint32_t __rxOverflow = 0;
+    // posted by the rx isr, readBytes() waits on it
+    SEM_HANDLE __rxSem = NULL;
+
+    // tx ring, write() is the only producer and the tx isr the only consumer,
+    // __mutex serializes writers from different threads
+    MUTEX_HANDLE __mutex = NULL;
+    SEM_HANDLE __txSem = NULL;
+    SerialRingBuffer _txBuffer;
+    size_t __txBufSize = SERIAL_TX_BUFFER_SIZE;
 };
 
 }
@@ -75,6 +75,26 @@ OPERATE_RET tkl_pwm_multichannel_start(TUYA_PWM_NUM_E *ch_id, UINT8_T num);
  */
 OPERATE_RET tkl_pwm_multichannel_stop(TUYA_PWM_NUM_E *ch_id, UINT8_T num);
 
+/**
+ * @brief start several independent pwm channels on aligned periods
+ *
+ * @param[in] ch_id: pwm channal id list
+ * @param[in] num  : num of pwm channal, all of them must use the same frequency
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_pwm_group_start(TUYA_PWM_NUM_E *ch_id, UINT8_T num);
+
+/**
+ * @brief stop pwm channels started with tkl_pwm_group_start
+ *
+ * @param[in] ch_id: pwm channal id list
+ * @param[in] num  : num of pwm channal
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_pwm_group_stop(TUYA_PWM_NUM_E *ch_id, UINT8_T num);
+
 /**
  * @brief pwm duty set
  * 
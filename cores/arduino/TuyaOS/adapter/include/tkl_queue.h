@@ -63,6 +63,77 @@ OPERATE_RET tkl_queue_fetch(CONST TKL_QUEUE_HANDLE queue, VOID_T *msg, UINT_T ti
  */
 VOID_T tkl_queue_free(CONST TKL_QUEUE_HANDLE queue);
 
+/*
+ * Message queue passing pointers. Messages live in slots of a pool created
+ * with the queue: the producer takes a slot, fills it in place and posts the
+ * pointer, the consumer gives the slot back once done. Only a pointer is
+ * copied whatever the message size. Every call may be made from an interrupt
+ * with timeout 0. A timeout of 0 does not wait, others are rounded up to
+ * whole ticks.
+ */
+typedef VOID_T* TKL_MSGQ_HANDLE;
+
+/**
+ * @brief Create a pointer queue and its pool of message slots
+ *
+ * @param[out] msgq the queue handle created
+ * @param[in] msgsize size of a slot
+ * @param[in] msgcount number of slots, the queue holds all of them
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_msgq_create(TKL_MSGQ_HANDLE *msgq, UINT_T msgsize, UINT_T msgcount);
+
+/**
+ * @brief Take a free slot
+ *
+ * @param[in] msgq the queue handle
+ * @param[in] timeout ms to wait for a slot, TKL_QUEUE_WAIT_FROEVER for ever
+ *
+ * @return the slot, NULL when none got free in time
+ */
+VOID_T *tkl_msgq_alloc(CONST TKL_MSGQ_HANDLE msgq, UINT_T timeout);
+
+/**
+ * @brief Post a slot taken with tkl_msgq_alloc(), never waits; a slot already posted is refused
+ *
+ * @param[in] msgq the queue handle
+ * @param[in] msg the slot
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_msgq_post(CONST TKL_MSGQ_HANDLE msgq, VOID_T *msg);
+
+/**
+ * @brief Fetch the oldest posted slot, give it back with tkl_msgq_free()
+ *
+ * @param[in] msgq the queue handle
+ * @param[out] msg the slot
+ * @param[in] timeout ms to wait for a message, TKL_QUEUE_WAIT_FROEVER for ever
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_msgq_fetch(CONST TKL_MSGQ_HANDLE msgq, VOID_T **msg, UINT_T timeout);
+
+/**
+ * @brief Give a slot back to the pool
+ *
+ * @param[in] msgq the queue handle
+ * @param[in] msg the slot, from tkl_msgq_alloc() or tkl_msgq_fetch()
+ *
+ * @return VOID_T
+ */
+VOID_T tkl_msgq_free(CONST TKL_MSGQ_HANDLE msgq, VOID_T *msg);
+
+/**
+ * @brief Delete the queue and its pool, no slot may be in use
+ *
+ * @param[in] msgq the queue handle
+ *
+ * @return VOID_T
+ */
+VOID_T tkl_msgq_release(CONST TKL_MSGQ_HANDLE msgq);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
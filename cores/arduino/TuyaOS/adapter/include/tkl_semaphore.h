@@ -11,6 +11,7 @@
 #define __TKL_SEMAPHORE_H__
 
 #include "tuya_cloud_types.h"
+#include "tkl_thread.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -66,6 +67,31 @@ OPERATE_RET tkl_semaphore_post(CONST TKL_SEM_HANDLE handle);
 */
 OPERATE_RET tkl_semaphore_release(CONST TKL_SEM_HANDLE handle);
 
+/**
+* @brief Post the notification semaphore of a thread
+*
+* @param[in] thread: the thread waiting in tkl_semaphore_notify_wait()
+*
+* @note A counting semaphore built into the thread, for the usual case of one
+* waiter: nothing to create and no queue behind it. The FreeRTOS notification
+* value of the thread is used, it must not be notified by other means. May be
+* called from an interrupt.
+*
+* @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+*/
+OPERATE_RET tkl_semaphore_notify_post(CONST TKL_THREAD_HANDLE thread);
+
+/**
+* @brief Wait on the notification semaphore of the calling thread
+*
+* @param[in] timeout: wait timeout in ms, 0 does not wait, TKL_SEM_WAIT_FOREVER waits for ever
+*
+* @note Takes one post, like tkl_semaphore_wait().
+*
+* @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+*/
+OPERATE_RET tkl_semaphore_notify_wait(CONST UINT_T timeout);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
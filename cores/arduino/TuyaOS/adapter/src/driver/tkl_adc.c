@@ -16,6 +16,9 @@
 #define ADC_REGISTER_VAL_MAX  4096
 #define ADC_VOLTAGE_MAX  2400   //mv
 
+// a conversion takes tens of microseconds, spin this long before sleeping a tick
+#define ADC_POLL_SPIN_CNT  5000
+
 static saradc_desc_t adc_desc = {0};  //ADC结构体
 static unsigned char g_adc_init[ADC_DEV_CHANNEL_SUM] = {FALSE};
 static unsigned char adc_ch_nums = 0;   // 实际使用的通道数
@@ -57,7 +60,7 @@ OPERATE_RET tkl_adc_init(TUYA_ADC_NUM_E port_num, TUYA_ADC_BASE_CFG_T *cfg)
     adc_desc.samp_rate = 0x20;  // bk advise not to change
     adc_desc.p_Int_Handler = saradc_disable;
     
-    for (i = 0; i < ADC_DEV_CHANNEL_SUM; i++) {
+    for (i = 0; i < cfg->ch_nums; i++) {
         channel = cfg->ch_list[i];
         if (channel < ADC_DEV_CHANNEL_SUM) {
             g_adc_init[channel] = TRUE;
@@ -144,6 +147,7 @@ OPERATE_RET tkl_adc_read_data(TUYA_ADC_NUM_E port_num, INT32_T *buff, UINT16_T l
 OPERATE_RET tkl_adc_read_single_channel(TUYA_ADC_NUM_E port_num, UINT8_T ch_id, INT32_T *data)
 {
     signed char i = 0;
+    unsigned int spin = 0;
     unsigned int status;
     int adc_hdl;
     unsigned short temp_adc_mv = 0;
@@ -184,6 +188,10 @@ OPERATE_RET tkl_adc_read_single_channel(TUYA_ADC_NUM_E port_num, UINT8_T ch_id,
     }
     GLOBAL_INT_RESTORE();
 
+    for (spin = 0; (adc_desc.all_done == 0) && (spin < ADC_POLL_SPIN_CNT); spin++) {
+        ;
+    }
+
     while (adc_desc.all_done == 0)
     {
         i++;
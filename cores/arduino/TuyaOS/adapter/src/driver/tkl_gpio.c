@@ -7,6 +7,8 @@ typedef struct {
     bk_gpio_t           gpio;
     TUYA_GPIO_IRQ_CB     cb;
     void                *args;
+    unsigned char        trigger;
+    unsigned char        both_edge;   // TUYA_GPIO_IRQ_RISE_FALL, trigger follows the pin level
 } pin_dev_map_t;
 
 static pin_dev_map_t pinmap[] = {
@@ -61,9 +63,7 @@ OPERATE_RET tkl_gpio_init(TUYA_GPIO_NUM_E pin_id, CONST TUYA_GPIO_BASE_CFG_T *cf
         default:
             return OPRT_NOT_SUPPORTED;
     }
-    BkGpioInitialize(pinmap[pin_id].gpio, bk_gpio_cfg);
-
-    //! set pin init level
+    //! set pin init level, latched before the pin drives so it does not glitch
     if (TUYA_GPIO_OUTPUT == cfg->direct) {
         if(TUYA_GPIO_LEVEL_LOW == cfg->level)
         {
@@ -75,6 +75,8 @@ OPERATE_RET tkl_gpio_init(TUYA_GPIO_NUM_E pin_id, CONST TUYA_GPIO_BASE_CFG_T *cf
         }
     }
 
+    BkGpioInitialize(pinmap[pin_id].gpio, bk_gpio_cfg);
+
     return OPRT_OK;
 }
 
@@ -142,6 +144,13 @@ OPERATE_RET tkl_gpio_read(TUYA_GPIO_NUM_E pin_id, TUYA_GPIO_LEVEL_E *level)
 static void __tkl_gpio_irq_cb(void *arg)
 {
     TUYA_GPIO_NUM_E pin_id = (TUYA_GPIO_NUM_E)arg;
+
+    // the hardware has no both-edge trigger, arm the edge opposite to the level just reached
+    if (pinmap[pin_id].both_edge) {
+        pinmap[pin_id].trigger = gpio_input(pinmap[pin_id].gpio) ? IRQ_TRIGGER_FALLING_EDGE : IRQ_TRIGGER_RISING_EDGE;
+        gpio_int_mode_set(pinmap[pin_id].gpio, pinmap[pin_id].trigger);
+    }
+
     if(pinmap[pin_id].cb){
         pinmap[pin_id].cb(pinmap[pin_id].args);
     }
@@ -176,6 +185,9 @@ OPERATE_RET tkl_gpio_irq_init(TUYA_GPIO_NUM_E pin_id, CONST TUYA_GPIO_IRQ_T *cfg
         case TUYA_GPIO_IRQ_FALL:
             trigger = IRQ_TRIGGER_FALLING_EDGE;
             break;
+        case TUYA_GPIO_IRQ_RISE_FALL:
+            trigger = gpio_input(pinmap[pin_id].gpio) ? IRQ_TRIGGER_FALLING_EDGE : IRQ_TRIGGER_RISING_EDGE;
+            break;
         case TUYA_GPIO_IRQ_LOW:
             trigger = IRQ_TRIGGER_LOW_LEVEL;
             break;
@@ -188,6 +200,8 @@ OPERATE_RET tkl_gpio_irq_init(TUYA_GPIO_NUM_E pin_id, CONST TUYA_GPIO_IRQ_T *cfg
 
     pinmap[pin_id].cb = cfg->cb;
     pinmap[pin_id].args = cfg->arg;
+    pinmap[pin_id].trigger = trigger;
+    pinmap[pin_id].both_edge = (TUYA_GPIO_IRQ_RISE_FALL == cfg->mode);
     BkGpioEnableIRQ(pinmap[pin_id].gpio, trigger, (bk_gpio_irq_handler_t)__tkl_gpio_irq_cb, NULL);
 
     return OPRT_OK;
@@ -203,6 +217,15 @@ OPERATE_RET tkl_gpio_irq_init(TUYA_GPIO_NUM_E pin_id, CONST TUYA_GPIO_IRQ_T *cfg
 OPERATE_RET tkl_gpio_irq_enable(TUYA_GPIO_NUM_E pin_id)
 {
     PIN_DEV_CHECK_ERROR_RETURN(pin_id, OPRT_INVALID_PARM);
+
+    // tkl_gpio_irq_init() already enabled it, this re-arms after tkl_gpio_irq_disable()
+    if (pinmap[pin_id].cb) {
+        if (pinmap[pin_id].both_edge) {
+            pinmap[pin_id].trigger = gpio_input(pinmap[pin_id].gpio) ? IRQ_TRIGGER_FALLING_EDGE : IRQ_TRIGGER_RISING_EDGE;
+        }
+        BkGpioIntConfig(pinmap[pin_id].gpio, pinmap[pin_id].trigger, (bk_gpio_irq_handler_t)__tkl_gpio_irq_cb, NULL);
+    }
+
     return OPRT_OK;
 }
 
@@ -9,8 +9,15 @@ TKL_PWM1_CH6 = GPIO6
 
 #define PWM_DEV_NUM             6
 
+#define PWM_CLK_FREQ            (26 * 1000000)
+#define PWM_DUTY_MAX            10000
+
 static TUYA_PWM_BASE_CFG_T pwm_cfg[PWM_DEV_NUM] = {{0}};
 static unsigned char pwm_start_flag[PWM_DEV_NUM] = {0};
+// period count the channel is running with, a duty change alone only rewrites the duty
+static unsigned int pwm_count[PWM_DEV_NUM] = {0};
+// channels started together by tkl_pwm_group_start(), their periods are aligned
+static unsigned int pwm_group_mask[PWM_DEV_NUM] = {0};
 
 /**
  * @brief pwm init
@@ -22,7 +29,7 @@ static unsigned char pwm_start_flag[PWM_DEV_NUM] = {0};
  */
 OPERATE_RET tkl_pwm_init(TUYA_PWM_NUM_E ch_id, CONST TUYA_PWM_BASE_CFG_T *cfg)
 {
-    if (ch_id > PWM_DEV_NUM)
+    if (ch_id >= PWM_DEV_NUM)
     {
         return OPRT_INVALID_PARM;
     }
@@ -59,13 +66,13 @@ OPERATE_RET tkl_pwm_start(TUYA_PWM_NUM_E ch_id)
     unsigned int count;
     unsigned int duty;
     
-    if (ch_id > PWM_DEV_NUM)
+    if ((ch_id >= PWM_DEV_NUM) || (0 == pwm_cfg[ch_id].frequency))
     {
         return OPRT_INVALID_PARM;
     }
 
-    count = (unsigned int)((26 * 1000000) / pwm_cfg[ch_id].frequency);  // 26M(主频) / 频率 = 计数值
-    duty = (unsigned int)(pwm_cfg[ch_id].duty * count / 10000);         // 一个周期的计数值 * 占空比
+    count = (unsigned int)(PWM_CLK_FREQ / pwm_cfg[ch_id].frequency);  // 26M(主频) / 频率 = 计数值
+    duty = (unsigned int)((unsigned long long)pwm_cfg[ch_id].duty * count / PWM_DUTY_MAX);  // 一个周期的计数值 * 占空比
     if (0 == pwm_start_flag[ch_id]) {
         ret = bk_pwm_initialize(ch_id, count, duty, 0, 0);
         if (kNoErr == ret) {
@@ -73,8 +80,15 @@ OPERATE_RET tkl_pwm_start(TUYA_PWM_NUM_E ch_id)
         } 
         ret = kNoErr == ret ? OPRT_OK : OPRT_COM_ERROR;
         pwm_start_flag[ch_id] = !ret;
+        pwm_count[ch_id] = count;
+        pwm_group_mask[ch_id] = 0;
+    } else if (count == pwm_count[ch_id]) {
+        // same period, the new duty is latched at the period end without a restart
+        ret = kNoErr == bk_pwm_update_duty(ch_id, duty) ? OPRT_OK : OPRT_COM_ERROR;
     } else {
         bk_pwm_update_param(ch_id, count, duty, 0, 0);
+        pwm_count[ch_id] = count;
+        pwm_group_mask[ch_id] = 0;
     }
 
     return ret;
@@ -96,7 +110,7 @@ OPERATE_RET tkl_pwm_multichannel_start(TUYA_PWM_NUM_E *ch_id, UINT8_T num)
     unsigned int dead = 0;
     
     if (2 == num) {
-        if ((ch_id[0] > PWM_DEV_NUM) || (ch_id[1] > PWM_DEV_NUM))
+        if ((ch_id[0] >= PWM_DEV_NUM) || (ch_id[1] >= PWM_DEV_NUM))
         {
             return OPRT_INVALID_PARM;
         }
@@ -105,7 +119,7 @@ OPERATE_RET tkl_pwm_multichannel_start(TUYA_PWM_NUM_E *ch_id, UINT8_T num)
             return OPRT_COM_ERROR;
         }
         
-        count = (unsigned int)((26 * 1000000) / pwm_cfg[ch_id[0]].frequency);       // 26M(主频) / 频率 = 计数值
+        count = (unsigned int)(PWM_CLK_FREQ / pwm_cfg[ch_id[0]].frequency);       // 26M(主频) / 频率 = 计数值
         cold_duty = (unsigned int)(pwm_cfg[ch_id[0]].duty * count / 10000);         // 一个周期的计数值 * 占空比
         warm_duty = (unsigned int)(pwm_cfg[ch_id[1]].duty * count / 10000);         // 一个周期的计数值 * 占空比
         if (count >= cold_duty + warm_duty) {
@@ -124,6 +138,10 @@ OPERATE_RET tkl_pwm_multichannel_start(TUYA_PWM_NUM_E *ch_id, UINT8_T num)
             ret = kNoErr == ret ? OPRT_OK : OPRT_COM_ERROR;
             pwm_start_flag[ch_id[0]] = !ret;
             pwm_start_flag[ch_id[1]] = !ret;
+            pwm_count[ch_id[0]] = 0;
+            pwm_count[ch_id[1]] = 0;
+            pwm_group_mask[ch_id[0]] = 0;
+            pwm_group_mask[ch_id[1]] = 0;
         } else {
             ret = bk_pwm_cw_update_param(ch_id[0], ch_id[1], count, cold_duty, warm_duty, dead);
             ret = kNoErr == ret ? OPRT_OK : OPRT_COM_ERROR;
@@ -135,6 +153,106 @@ OPERATE_RET tkl_pwm_multichannel_start(TUYA_PWM_NUM_E *ch_id, UINT8_T num)
     }
 }
 
+/**
+ * @brief start several independent pwm channels on aligned periods
+ *
+ * @param[in] ch_id: pwm channal id list
+ * @param[in] num  : num of pwm channal, all of them must use the same frequency
+ *
+ * @note the channels are started together the first time, later calls only
+ *       latch the new duties of all channels at the same period boundary
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_pwm_group_start(TUYA_PWM_NUM_E *ch_id, UINT8_T num)
+{
+    int ret = OPRT_OK;
+    unsigned int i;
+    unsigned int mask = 0;
+    unsigned int count;
+    unsigned int duty[PWM_DEV_NUM] = {0};
+    unsigned char synced = 1;
+
+    if ((NULL == ch_id) || (0 == num) || (num > PWM_DEV_NUM)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    for (i = 0; i < num; i++) {
+        if ((ch_id[i] >= PWM_DEV_NUM) || (0 == pwm_cfg[ch_id[i]].frequency)) {
+            return OPRT_INVALID_PARM;
+        }
+        if (pwm_cfg[ch_id[i]].frequency != pwm_cfg[ch_id[0]].frequency) {
+            return OPRT_COM_ERROR;
+        }
+        mask |= (1 << ch_id[i]);
+    }
+
+    count = (unsigned int)(PWM_CLK_FREQ / pwm_cfg[ch_id[0]].frequency);
+    for (i = 0; i < num; i++) {
+        duty[ch_id[i]] = (unsigned int)((unsigned long long)pwm_cfg[ch_id[i]].duty * count / PWM_DUTY_MAX);
+        if (!pwm_start_flag[ch_id[i]] || (pwm_group_mask[ch_id[i]] != mask) || (pwm_count[ch_id[i]] != count)) {
+            synced = 0;
+        }
+    }
+
+    if (synced) {
+        return kNoErr == bk_pwm_multi_update_duty(mask, duty) ? OPRT_OK : OPRT_COM_ERROR;
+    }
+
+    // (re)start every channel from the same instant
+    for (i = 0; i < num; i++) {
+        if (pwm_start_flag[ch_id[i]]) {
+            bk_pwm_stop(ch_id[i]);
+            pwm_start_flag[ch_id[i]] = 0;
+        }
+        if (kNoErr != bk_pwm_initialize(ch_id[i], count, duty[ch_id[i]], 0, 0)) {
+            ret = OPRT_COM_ERROR;
+        }
+    }
+    if (OPRT_OK == ret) {
+        ret = kNoErr == bk_pwm_multi_start(mask) ? OPRT_OK : OPRT_COM_ERROR;
+    }
+
+    for (i = 0; i < num; i++) {
+        pwm_start_flag[ch_id[i]] = !ret;
+        pwm_count[ch_id[i]] = count;
+        pwm_group_mask[ch_id[i]] = (OPRT_OK == ret) ? mask : 0;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief stop pwm channels started with tkl_pwm_group_start
+ *
+ * @param[in] ch_id: pwm channal id list
+ * @param[in] num  : num of pwm channal
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_pwm_group_stop(TUYA_PWM_NUM_E *ch_id, UINT8_T num)
+{
+    unsigned int i;
+
+    if (NULL == ch_id) {
+        return OPRT_INVALID_PARM;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (ch_id[i] >= PWM_DEV_NUM) {
+            return OPRT_INVALID_PARM;
+        }
+    }
+
+    for (i = 0; i < num; i++) {
+        bk_pwm_stop(ch_id[i]);
+        pwm_start_flag[ch_id[i]] = 0;
+        pwm_group_mask[ch_id[i]] = 0;
+    }
+
+    return OPRT_OK;
+}
+
 /**
  * @brief pwm stop
  * 
@@ -144,13 +262,14 @@ OPERATE_RET tkl_pwm_multichannel_start(TUYA_PWM_NUM_E *ch_id, UINT8_T num)
  */
 OPERATE_RET tkl_pwm_stop(TUYA_PWM_NUM_E ch_id)
 {
-    if (ch_id > PWM_DEV_NUM)
+    if (ch_id >= PWM_DEV_NUM)
     {
         return OPRT_INVALID_PARM;
     }
 
     bk_pwm_stop(ch_id);
     pwm_start_flag[ch_id] = 0;
+    pwm_group_mask[ch_id] = 0;
 
     return OPRT_OK;
 }
@@ -166,7 +285,7 @@ OPERATE_RET tkl_pwm_stop(TUYA_PWM_NUM_E ch_id)
 OPERATE_RET tkl_pwm_multichannel_stop(TUYA_PWM_NUM_E *ch_id, UINT8_T num)
 {
     if (2 == num) {
-        if ((ch_id[0] > PWM_DEV_NUM) || (ch_id[1] > PWM_DEV_NUM))
+        if ((ch_id[0] >= PWM_DEV_NUM) || (ch_id[1] >= PWM_DEV_NUM))
         {
             return OPRT_INVALID_PARM;
         }
@@ -191,7 +310,7 @@ OPERATE_RET tkl_pwm_multichannel_stop(TUYA_PWM_NUM_E *ch_id, UINT8_T num)
  */
 OPERATE_RET tkl_pwm_duty_set(TUYA_PWM_NUM_E ch_id, UINT32_T duty)
 {
-    if (ch_id > PWM_DEV_NUM)
+    if (ch_id >= PWM_DEV_NUM)
     {
         return OPRT_INVALID_PARM;
     }
@@ -211,7 +330,7 @@ OPERATE_RET tkl_pwm_duty_set(TUYA_PWM_NUM_E ch_id, UINT32_T duty)
  */
 OPERATE_RET tkl_pwm_frequency_set(TUYA_PWM_NUM_E ch_id, UINT32_T frequency)
 {
-    if (ch_id > PWM_DEV_NUM)
+    if (ch_id >= PWM_DEV_NUM)
     {
         return OPRT_INVALID_PARM;
     }
@@ -244,7 +363,7 @@ OPERATE_RET tkl_pwm_polarity_set(TUYA_PWM_NUM_E ch_id, TUYA_PWM_POLARITY_E polar
  */
 OPERATE_RET tkl_pwm_info_set(TUYA_PWM_NUM_E ch_id, CONST TUYA_PWM_BASE_CFG_T *info)
 {
-    if (ch_id > PWM_DEV_NUM)
+    if (ch_id >= PWM_DEV_NUM)
     {
         return OPRT_INVALID_PARM;
     }
@@ -266,7 +385,7 @@ OPERATE_RET tkl_pwm_info_set(TUYA_PWM_NUM_E ch_id, CONST TUYA_PWM_BASE_CFG_T *in
  */
 OPERATE_RET tkl_pwm_info_get(TUYA_PWM_NUM_E ch_id, TUYA_PWM_BASE_CFG_T *info)
 {
-    if (ch_id > PWM_DEV_NUM)
+    if (ch_id >= PWM_DEV_NUM)
     {
         return OPRT_INVALID_PARM;
     }
@@ -29,10 +29,17 @@ void tkl_spi_set_spic_flag(void)
 OPERATE_RET tkl_spi_init(TUYA_SPI_NUM_E port, CONST TUYA_SPI_BASE_CFG_T *cfg)
 {
     if(cfg->role == TUYA_SPI_ROLE_MASTER) {
-        uint8_t mode ;
-        mode |= (cfg->mode & 0x1) << 2;
-        mode |= (cfg->mode & 0x2) << 1;
+        uint8_t mode = 0;
+        uint8_t lsb = 0;
+        if (cfg->mode & 0x1) {
+            mode |= BK_SPI_CPHA;
+        }
+        if (cfg->mode & 0x2) {
+            mode |= BK_SPI_CPOL;
+        }
         bk_spi_master_dma_init(mode, cfg->freq_hz, spic_flag);
+        lsb = (cfg->bitorder == TUYA_SPI_ORDER_LSB2MSB) ? 1 : 0;
+        sddev_control(SPI_DEV_NAME, CMD_SPI_LSB_EN, &lsb);
         // 若cs_pin 为15号脚，pin脚初始化需在spi初始化之后，否则该管脚无法控制
         cs_auto_flag = (cfg->type == TUYA_SPI_AUTO_TYPE) ? true : false;
         if(cs_auto_flag) {
@@ -1,10 +1,22 @@
 #include "tkl_timer.h"
 
 #include "BkDriverTimer.h"
+#include "bk_timer_pub.h"
+#include "FreeRTOSConfig.h"
 
 /* private macros */
 #define TIMER_DEV_NUM       4
 
+/* bk timer behind a tkl timer, bk timer2、3 are taken by the system */
+#define TIMER_BK_ID(id)     (((id) < 2) ? (id) : ((id) + 2))
+
+/* the rtos run time stats counter keeps its bk timer running for good, the analog sampler owns another */
+#if (configGENERATE_RUN_TIME_STATS == 1)
+#define TIMER_IS_TAKEN(id)  ((BK_TIMER_RUNTIME_ID == TIMER_BK_ID(id)) || (BK_TIMER_SAMPLER_ID == TIMER_BK_ID(id)))
+#else
+#define TIMER_IS_TAKEN(id)  (BK_TIMER_SAMPLER_ID == TIMER_BK_ID(id))
+#endif
+
 /* private variables */
 static TUYA_TIMER_BASE_CFG_E timer_map[] = {
     {TUYA_TIMER_MODE_ONCE, NULL, NULL},
@@ -47,7 +59,7 @@ static void __tkl_hw_timer_cb(void *args)
  */
 OPERATE_RET tkl_timer_init(TUYA_TIMER_NUM_E timer_id, TUYA_TIMER_BASE_CFG_E *cfg)
 {
-    if (timer_id >= TIMER_DEV_NUM) {
+    if (timer_id >= TIMER_DEV_NUM || TIMER_IS_TAKEN(timer_id)) {
         return OPRT_NOT_SUPPORTED;
     }
     if(cfg == NULL){
@@ -72,7 +84,7 @@ OPERATE_RET tkl_timer_init(TUYA_TIMER_NUM_E timer_id, TUYA_TIMER_BASE_CFG_E *cfg
  */
 OPERATE_RET tkl_timer_start(TUYA_TIMER_NUM_E timer_id, UINT_T us)
 {
-    if (timer_id >= TIMER_DEV_NUM) {
+    if (timer_id >= TIMER_DEV_NUM || TIMER_IS_TAKEN(timer_id)) {
         return OPRT_NOT_SUPPORTED;
     }
 
@@ -99,7 +111,7 @@ OPERATE_RET tkl_timer_start(TUYA_TIMER_NUM_E timer_id, UINT_T us)
  */
 OPERATE_RET tkl_timer_stop(TUYA_TIMER_NUM_E timer_id)
 {
-    if (timer_id >= TIMER_DEV_NUM) {
+    if (timer_id >= TIMER_DEV_NUM || TIMER_IS_TAKEN(timer_id)) {
         return OPRT_NOT_SUPPORTED;
     }
 
@@ -137,6 +149,10 @@ OPERATE_RET tkl_timer_get(TUYA_TIMER_NUM_E timer_id, UINT_T *us)
 {
     uint32_t count;
 
+    if (TIMER_IS_TAKEN(timer_id)) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
     if ((0 == timer_id) || (1 == timer_id)) {
         bk_timer_read_cnt(timer_id, &count);
 
@@ -4,6 +4,12 @@
 #include "uart_pub.h"
 #include "BkDriverUart.h"
 
+extern void uart_set_tx_fifo_needwr_int(UINT8 uport, UINT8 set);
+extern int uart_tx_fifo_needwr_callback_set(int uport, uart_callback callback, void *param);
+
+/* set by tkl_uart_tx_irq_cb_reg, write only fills the tx fifo and never waits */
+static BOOL_T s_uart_tx_async[2] = {FALSE, FALSE};
+
 /**
  * @brief uart init
  * 
@@ -129,6 +135,16 @@ INT_T tkl_uart_write(TUYA_UART_NUM_E port_id, VOID_T *buff, UINT16_T len)
         return OPRT_INVALID_PARM;
     }
 
+    if (s_uart_tx_async[port]) {
+        for ( i = 0; i < len; i++) {
+            if (uart_is_tx_fifo_full(port)) {
+                break;
+            }
+            uart_write_byte(port, *(UINT8*)(buff+i));
+        }
+        return i;
+    }
+
     for ( i = 0; i < len; i++) {
         bk_send_byte( port, *(UINT8*)(buff+i));
     }
@@ -189,6 +205,18 @@ INT_T tkl_uart_read(TUYA_UART_NUM_E port_id, VOID_T *buff, UINT16_T len)
  */
 OPERATE_RET tkl_uart_set_tx_int(TUYA_UART_NUM_E port_id, BOOL_T enable)
 {
+    bk_uart_t port;
+
+    if ( 0 == TUYA_UART_GET_PORT_NUMBER(port_id)) {
+        port = BK_UART_1;
+    } else if ( 1 == TUYA_UART_GET_PORT_NUMBER(port_id)) {
+        port = BK_UART_2;
+    } else {
+        return OPRT_INVALID_PARM;
+    }
+
+    uart_set_tx_fifo_needwr_int(port, enable ? 1 : 0);
+
     return OPRT_OK;
 }
 
@@ -259,5 +287,58 @@ VOID_T tkl_uart_rx_irq_cb_reg(TUYA_UART_NUM_E port_id, TUYA_UART_IRQ_CB rx_cb)
  */
 VOID_T tkl_uart_tx_irq_cb_reg(TUYA_UART_NUM_E port_id, TUYA_UART_IRQ_CB tx_cb)
 {
-    
+    bk_uart_t port;
+
+    if ( 0 == TUYA_UART_GET_PORT_NUMBER(port_id)) {
+        port = BK_UART_1;
+    } else if ( 1 == TUYA_UART_GET_PORT_NUMBER(port_id)) {
+        port = BK_UART_2;
+    } else {
+        return ;
+    }
+
+    if (NULL == tx_cb) {
+        uart_set_tx_fifo_needwr_int(port, 0);
+        uart_tx_fifo_needwr_callback_set(port, NULL, NULL);
+        s_uart_tx_async[port] = FALSE;
+        return;
+    }
+
+    s_uart_tx_async[port] = TRUE;
+    uart_tx_fifo_needwr_callback_set(port, uart_dev_irq_handler, tx_cb);
+}
+
+/**
+ * @brief uart control
+ *
+ * @param[in] port_id: uart port id
+ * @param[in] cmd: control command, only TUYA_UART_FLUSH_CMD is supported,
+ *                 it waits until the tx fifo is empty
+ * @param[in] arg: command argument
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_uart_ioctl(TUYA_UART_NUM_E port_id, UINT32_T cmd, VOID *arg)
+{
+    bk_uart_t port;
+
+    if ( 0 == TUYA_UART_GET_PORT_NUMBER(port_id)) {
+        port = BK_UART_1;
+    } else if ( 1 == TUYA_UART_GET_PORT_NUMBER(port_id)) {
+        port = BK_UART_2;
+    } else {
+        return OPRT_INVALID_PARM;
+    }
+
+    switch (cmd) {
+        case TUYA_UART_FLUSH_CMD:
+            while (!uart_is_tx_fifo_empty(port)) {
+                ;
+            }
+            break;
+        default:
+            return OPRT_NOT_SUPPORTED;
+    }
+
+    return OPRT_OK;
 }
@@ -13,6 +13,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "rtos_trace.h"
 
 /**
 * @brief Create mutex
@@ -57,11 +58,13 @@ OPERATE_RET tkl_mutex_lock(CONST TKL_MUTEX_HANDLE handle)
     }
     
     BaseType_t ret;
+    RTOS_TRACE(RTOS_TRACE_MUTEX_LOCK, 0, 0, handle);
 #if configUSE_RECURSIVE_MUTEXES
     ret = xSemaphoreTakeRecursive(handle, portMAX_DELAY);
 #else
     ret = xSemaphoreTake(handle, portMAX_DELAY);
 #endif
+    RTOS_TRACE(RTOS_TRACE_MUTEX_LOCKED, pdTRUE == ret, 0, handle);
     if (pdTRUE != ret) {
         return OPRT_OS_ADAPTER_MUTEX_LOCK_FAILED;
     }
@@ -86,6 +89,7 @@ OPERATE_RET tkl_mutex_unlock(CONST TKL_MUTEX_HANDLE handle)
         return OPRT_INVALID_PARM;
     }
     
+    RTOS_TRACE(RTOS_TRACE_MUTEX_UNLOCK, 0, 0, handle);
 #if configUSE_RECURSIVE_MUTEXES
     ret = xSemaphoreGiveRecursive(handle);
 #else
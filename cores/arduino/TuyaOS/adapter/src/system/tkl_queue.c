@@ -10,15 +10,39 @@
 
 #include "tkl_queue.h"
 #include "tkl_system.h"
+#include "tkl_memory.h"
+#include "tkl_output.h"
 
+#include <string.h>
+
+#include "include.h"
+#include "arm_arch.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "rtos_trace.h"
 
 typedef struct {
     xQueueHandle queue;
 } QUEUE_MANAGE, *P_QUEUE_MANAGE;
 
+#define MSGQ_SLOT_FREE      0
+#define MSGQ_SLOT_USED      1   // allocated or fetched, the caller owns it
+#define MSGQ_SLOT_POSTED    2   // in the queue
+
+typedef struct {
+    xQueueHandle msgs;      // posted slots
+    xSemaphoreHandle freed; // given on free while tkl_msgq_alloc() waits for a slot
+    VOID_T *free_list;      // a free slot holds the next one in its first word
+    UINT_T waiters;
+    UINT8_T *slots;
+    UINT8_T *state;         // MSGQ_SLOT_* of each slot
+    UINT_T slot_size;
+    UINT_T slot_count;
+} MSGQ_MANAGE, *P_MSGQ_MANAGE;
+
+extern uint32_t platform_is_in_interrupt_context(void);
+
 /**
  * @brief Create message queue
  *
@@ -78,6 +102,7 @@ OPERATE_RET tkl_queue_post(CONST TKL_QUEUE_HANDLE queue, VOID_T *data, UINT_T ti
         ret = xQueueSendFromISR(queue, data, &xHigherPriorityTaskWoken);
         portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
     }
+    RTOS_TRACE(RTOS_TRACE_TKL_POST, pdPASS == ret, 0, queue);
 
     if (pdPASS != ret) {
         return OPRT_OS_ADAPTER_QUEUE_SEND_FAIL;
@@ -108,6 +133,7 @@ OPERATE_RET tkl_queue_fetch(CONST TKL_QUEUE_HANDLE queue, VOID_T *msg, UINT_T ti
         msg = &dummyptr;
     }
 
+    RTOS_TRACE(RTOS_TRACE_TKL_FETCH, 0, 0, queue);
     if (timeout == TKL_QUEUE_WAIT_FROEVER) {
         ret = xQueueReceive(queue, msg, portMAX_DELAY);
     } else {
@@ -118,6 +144,7 @@ OPERATE_RET tkl_queue_fetch(CONST TKL_QUEUE_HANDLE queue, VOID_T *msg, UINT_T ti
         }
         ret = xQueueReceive(queue, msg, ticks);
     }
+    RTOS_TRACE(RTOS_TRACE_TKL_FETCHED, pdPASS == ret, 0, queue);
 								
     if (pdPASS != ret) {
         return OPRT_OS_ADAPTER_QUEUE_SEND_FAIL;
@@ -149,3 +176,313 @@ VOID_T tkl_queue_free(CONST TKL_QUEUE_HANDLE queue)
     vQueueDelete((QueueHandle_t)queue);
 }
 
+// 0 does not wait, anything else waits at least the time asked
+static TickType_t __msgq_ticks(UINT_T timeout)
+{
+    if (timeout == TKL_QUEUE_WAIT_FROEVER) {
+        return portMAX_DELAY;
+    }
+
+    return timeout / portTICK_RATE_MS + ((timeout % portTICK_RATE_MS) ? 1 : 0);
+}
+
+static BaseType_t __msgq_send(xQueueHandle queue, VOID_T **item, TickType_t ticks)
+{
+    BaseType_t ret;
+
+    if (!platform_is_in_interrupt_context()) {
+        return xQueueSend(queue, item, ticks);
+    }
+
+    signed portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+    ret = xQueueSendFromISR(queue, item, &xHigherPriorityTaskWoken);
+    portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+
+    return ret;
+}
+
+static BaseType_t __msgq_receive(xQueueHandle queue, VOID_T **item, TickType_t ticks)
+{
+    BaseType_t ret;
+
+    if (!platform_is_in_interrupt_context()) {
+        return xQueueReceive(queue, item, ticks);
+    }
+
+    signed portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+    ret = xQueueReceiveFromISR(queue, item, &xHigherPriorityTaskWoken);
+    portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+
+    return ret;
+}
+
+// index of the slot msg points at, -1 for anything else
+static INT_T __msgq_slot(P_MSGQ_MANAGE manage, VOID_T *msg)
+{
+    UINT_T offset = (UINT8_T *)msg - manage->slots;
+
+    if ((UINT8_T *)msg < manage->slots || offset >= manage->slot_size * manage->slot_count ||
+        offset % manage->slot_size) {
+        return -1;
+    }
+
+    return offset / manage->slot_size;
+}
+
+/**
+ * @brief Create a pointer queue and its pool of message slots
+ *
+ * @param[out] msgq the queue handle created
+ * @param[in] msgsize size of a slot
+ * @param[in] msgcount number of slots, the queue holds all of them
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_msgq_create(TKL_MSGQ_HANDLE *msgq, UINT_T msgsize, UINT_T msgcount)
+{
+    P_MSGQ_MANAGE manage;
+    VOID_T *slot;
+    UINT_T i;
+
+    if (!msgq || msgsize == 0 || msgcount == 0) {
+        return OPRT_OS_ADAPTER_INVALID_PARM;
+    }
+
+    *msgq = NULL;
+
+    manage = (P_MSGQ_MANAGE)tkl_system_malloc(sizeof(MSGQ_MANAGE));
+    if (manage == NULL) {
+        return OPRT_OS_ADAPTER_MALLOC_FAILED;
+    }
+    memset(manage, 0, sizeof(MSGQ_MANAGE));
+
+    // keep every slot 8 byte aligned, the slot states follow the slots
+    manage->slot_size = (msgsize + 7) & ~7;
+    manage->slot_count = msgcount;
+    manage->slots = (UINT8_T *)tkl_system_malloc(manage->slot_size * msgcount + msgcount);
+    manage->msgs = xQueueCreate(msgcount, sizeof(VOID_T *));
+    manage->freed = xSemaphoreCreateCounting(msgcount, 0);
+    if (manage->slots == NULL || manage->msgs == NULL || manage->freed == NULL) {
+        tkl_msgq_release(manage);
+        return OPRT_OS_ADAPTER_QUEUE_CREAT_FAILED;
+    }
+
+    manage->state = manage->slots + manage->slot_size * msgcount;
+    memset(manage->state, MSGQ_SLOT_FREE, msgcount);
+    for (i = msgcount; i > 0; i--) {
+        slot = manage->slots + (i - 1) * manage->slot_size;
+        *(VOID_T **)slot = manage->free_list;
+        manage->free_list = slot;
+    }
+
+    *msgq = (TKL_MSGQ_HANDLE)manage;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Take a free slot
+ *
+ * @param[in] msgq the queue handle
+ * @param[in] timeout ms to wait for a slot, TKL_QUEUE_WAIT_FROEVER for ever
+ *
+ * @return the slot, NULL when none got free in time
+ */
+VOID_T *tkl_msgq_alloc(CONST TKL_MSGQ_HANDLE msgq, UINT_T timeout)
+{
+    P_MSGQ_MANAGE manage = (P_MSGQ_MANAGE)msgq;
+    VOID_T *slot;
+    TickType_t ticks;
+    TimeOut_t time_out;
+    BaseType_t ret;
+    GLOBAL_INT_DECLARATION();
+
+    if (!manage) {
+        return NULL;
+    }
+
+    ticks = platform_is_in_interrupt_context() ? 0 : __msgq_ticks(timeout);
+    if (ticks) {
+        vTaskSetTimeOutState(&time_out);
+    }
+
+    // the free list costs no kernel call, the semaphore is only for waiting
+    for (;;) {
+        GLOBAL_INT_DISABLE();
+        slot = manage->free_list;
+        if (slot) {
+            manage->free_list = *(VOID_T **)slot;
+            manage->state[((UINT8_T *)slot - manage->slots) / manage->slot_size] = MSGQ_SLOT_USED;
+        } else if (ticks) {
+            manage->waiters++;
+        }
+        GLOBAL_INT_RESTORE();
+
+        if (slot || ticks == 0) {
+            return slot;
+        }
+
+        ret = xSemaphoreTake(manage->freed, ticks);
+
+        GLOBAL_INT_DISABLE();
+        manage->waiters--;
+        GLOBAL_INT_RESTORE();
+
+        // a last look at the free list once the time is up
+        if (pdTRUE != ret || pdTRUE == xTaskCheckForTimeOut(&time_out, &ticks)) {
+            ticks = 0;
+        }
+    }
+}
+
+/**
+ * @brief Post a slot taken with tkl_msgq_alloc(), never waits; a slot already posted is refused
+ *
+ * @param[in] msgq the queue handle
+ * @param[in] msg the slot
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_msgq_post(CONST TKL_MSGQ_HANDLE msgq, VOID_T *msg)
+{
+    P_MSGQ_MANAGE manage = (P_MSGQ_MANAGE)msgq;
+    INT_T index;
+    GLOBAL_INT_DECLARATION();
+
+    if (!manage || !msg) {
+        return OPRT_OS_ADAPTER_INVALID_PARM;
+    }
+
+    index = __msgq_slot(manage, msg);
+    if (index < 0) {
+        return OPRT_OS_ADAPTER_INVALID_PARM;
+    }
+
+    // a slot posted twice would be fetched twice
+    GLOBAL_INT_DISABLE();
+    if (manage->state[index] != MSGQ_SLOT_USED) {
+        GLOBAL_INT_RESTORE();
+        return OPRT_OS_ADAPTER_INVALID_PARM;
+    }
+    manage->state[index] = MSGQ_SLOT_POSTED;
+    GLOBAL_INT_RESTORE();
+
+    // there are no more slots than the queue holds, so it is never full
+    if (pdPASS != __msgq_send(manage->msgs, &msg, 0)) {
+        manage->state[index] = MSGQ_SLOT_USED;
+        return OPRT_OS_ADAPTER_QUEUE_SEND_FAIL;
+    }
+    RTOS_TRACE(RTOS_TRACE_TKL_POST, 1, 0, msgq);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Fetch the oldest posted slot, give it back with tkl_msgq_free()
+ *
+ * @param[in] msgq the queue handle
+ * @param[out] msg the slot
+ * @param[in] timeout ms to wait for a message, TKL_QUEUE_WAIT_FROEVER for ever
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_msgq_fetch(CONST TKL_MSGQ_HANDLE msgq, VOID_T **msg, UINT_T timeout)
+{
+    P_MSGQ_MANAGE manage = (P_MSGQ_MANAGE)msgq;
+    BaseType_t ret;
+
+    if (!manage || !msg) {
+        return OPRT_OS_ADAPTER_INVALID_PARM;
+    }
+
+    RTOS_TRACE(RTOS_TRACE_TKL_FETCH, 0, 0, msgq);
+    ret = __msgq_receive(manage->msgs, msg, __msgq_ticks(timeout));
+    RTOS_TRACE(RTOS_TRACE_TKL_FETCHED, pdPASS == ret, 0, msgq);
+    if (pdPASS != ret) {
+        *msg = NULL;
+        return OPRT_OS_ADAPTER_QUEUE_RECV_FAIL;
+    }
+
+    // only posted slots are in the queue, the fetcher owns it now
+    manage->state[__msgq_slot(manage, *msg)] = MSGQ_SLOT_USED;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Give a slot back to the pool
+ *
+ * @param[in] msgq the queue handle
+ * @param[in] msg the slot, from tkl_msgq_alloc() or tkl_msgq_fetch()
+ *
+ * @return VOID_T
+ */
+VOID_T tkl_msgq_free(CONST TKL_MSGQ_HANDLE msgq, VOID_T *msg)
+{
+    P_MSGQ_MANAGE manage = (P_MSGQ_MANAGE)msgq;
+    INT_T index;
+    UINT_T waiters;
+    GLOBAL_INT_DECLARATION();
+
+    if (!manage || !msg) {
+        return;
+    }
+
+    index = __msgq_slot(manage, msg);
+    if (index < 0) {
+        tkl_log_output("msgq: %p is not a slot of %p\r\n", msg, msgq);
+        return;
+    }
+
+    GLOBAL_INT_DISABLE();
+    // a slot on the free list twice would be handed out twice, one still queued would be fetched after it
+    if (manage->state[index] != MSGQ_SLOT_USED) {
+        GLOBAL_INT_RESTORE();
+        tkl_log_output("msgq: %p of %p is free or still queued\r\n", msg, msgq);
+        return;
+    }
+    manage->state[index] = MSGQ_SLOT_FREE;
+    *(VOID_T **)msg = manage->free_list;
+    manage->free_list = msg;
+    waiters = manage->waiters;
+    GLOBAL_INT_RESTORE();
+
+    if (!waiters) {
+        return;
+    }
+
+    if (!platform_is_in_interrupt_context()) {
+        xSemaphoreGive(manage->freed);
+    } else {
+        signed portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+        xSemaphoreGiveFromISR(manage->freed, &xHigherPriorityTaskWoken);
+        portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+    }
+}
+
+/**
+ * @brief Delete the queue and its pool, no slot may be in use
+ *
+ * @param[in] msgq the queue handle
+ *
+ * @return VOID_T
+ */
+VOID_T tkl_msgq_release(CONST TKL_MSGQ_HANDLE msgq)
+{
+    P_MSGQ_MANAGE manage = (P_MSGQ_MANAGE)msgq;
+
+    if (!manage) {
+        return;
+    }
+
+    if (manage->msgs) {
+        vQueueDelete(manage->msgs);
+    }
+    if (manage->freed) {
+        vSemaphoreDelete(manage->freed);
+    }
+    if (manage->slots) {
+        tkl_system_free(manage->slots);
+    }
+    tkl_system_free(manage);
+}
@@ -100,15 +100,12 @@ OPERATE_RET tkl_semaphore_post(CONST TKL_SEM_HANDLE handle)
         return OPRT_INVALID_PARM;
     }
     
-    P_TKL_SEM_MANAGE sem_manage;
-    sem_manage = (P_TKL_SEM_MANAGE)handle;
-
     BaseType_t ret;
     if (0 == bk_wlan_get_INT_status()) {
-        ret = xSemaphoreGive(sem_manage->sem);
+        ret = xSemaphoreGive(handle);
     } else {
         signed portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
-        ret = xSemaphoreGiveFromISR(sem_manage->sem,
+        ret = xSemaphoreGiveFromISR(handle,
                                     &xHigherPriorityTaskWoken);
         portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
     }
@@ -140,4 +137,55 @@ OPERATE_RET tkl_semaphore_release(CONST TKL_SEM_HANDLE handle)
     return OPRT_OK;
 }
 
+/**
+* @brief Post the notification semaphore of a thread
+*
+* @param[in] thread: the thread waiting in tkl_semaphore_notify_wait()
+*
+* @note This API is used for posting the semaphore built into a thread.
+*
+* @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+*/
+OPERATE_RET tkl_semaphore_notify_post(CONST TKL_THREAD_HANDLE thread)
+{
+    if(!thread) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (0 == bk_wlan_get_INT_status()) {
+        xTaskNotifyGive((TaskHandle_t)thread);
+    } else {
+        signed portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR((TaskHandle_t)thread, &xHigherPriorityTaskWoken);
+        portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+    }
+
+    return OPRT_OK;
+}
+
+/**
+* @brief Wait on the notification semaphore of the calling thread
+*
+* @param[in] timeout: wait timeout in ms, 0 does not wait, TKL_SEM_WAIT_FOREVER waits for ever
+*
+* @note This API is used for waiting the semaphore built into the calling thread.
+*
+* @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+*/
+OPERATE_RET tkl_semaphore_notify_wait(CONST UINT_T timeout)
+{
+    TickType_t ticks;
+
+    if (timeout == TKL_SEM_WAIT_FOREVER) {
+        ticks = portMAX_DELAY;
+    } else {
+        // round up, a wait is never shorter than asked
+        ticks = timeout / portTICK_RATE_MS + ((timeout % portTICK_RATE_MS) ? 1 : 0);
+    }
 
+    if (0 == ulTaskNotifyTake(pdFALSE, ticks)) {
+        return OPRT_OS_ADAPTER_SEM_WAIT_FAILED;
+    }
+
+    return OPRT_OK;
+}
@@ -64,13 +64,9 @@ String::String(const __FlashStringHelper *pstr)
 }
 
 String::String(String &&rval)
-	: buffer(rval.buffer)
-	, capacity(rval.capacity)
-	, len(rval.len)
 {
-	rval.buffer = NULL;
-	rval.capacity = 0;
-	rval.len = 0;
+	init();
+	move(rval);
 }
 
 String::String(char c)
@@ -142,7 +138,7 @@ String::String(double value, unsigned char decimalPlaces)
 
 String::~String()
 {
-	if (buffer) free(buffer);
+	release();
 }
 
 /*********************************************/
@@ -156,9 +152,14 @@ inline void String::init(void)
 	len = 0;
 }
 
+void String::release(void)
+{
+	if (buffer && !isInline()) free(buffer);
+}
+
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	release();
 	buffer = NULL;
 	capacity = len = 0;
 }
@@ -175,7 +176,26 @@ bool String::reserve(unsigned int size)
 
 bool String::changeBuffer(unsigned int maxStrLen)
 {
-	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	char *newbuffer;
+
+	if (!buffer && maxStrLen < STRING_INLINE_SIZE) {
+		buffer = inlineBuffer;
+		capacity = STRING_INLINE_SIZE - 1;
+		return true;
+	}
+
+	// a string that is already growing grows by half, so repeated
+	// concatenation copies each byte a bounded number of times
+	if (buffer && maxStrLen < capacity + capacity / 2) {
+		maxStrLen = capacity + capacity / 2;
+	}
+
+	if (isInline()) {
+		newbuffer = (char *)malloc(maxStrLen + 1);
+		if (newbuffer) memcpy(newbuffer, inlineBuffer, len + 1);
+	} else {
+		newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	}
 	if (newbuffer) {
 		buffer = newbuffer;
 		capacity = maxStrLen;
@@ -215,9 +235,15 @@ void String::move(String &rhs)
 {
 	if (this != &rhs)
 	{
-		free(buffer);
-
-		buffer = rhs.buffer;
+		release();
+
+		// a heap buffer is taken over, an inline one has to be copied
+		if (rhs.isInline()) {
+			memcpy(inlineBuffer, rhs.inlineBuffer, rhs.len + 1);
+			buffer = inlineBuffer;
+		} else {
+			buffer = rhs.buffer;
+		}
 		len = rhs.len;
 		capacity = rhs.capacity;
 
@@ -273,7 +299,12 @@ bool String::concat(const char *cstr, unsigned int length)
 	unsigned int newlen = len + length;
 	if (!cstr) return false;
 	if (length == 0) return true;
-	if (!reserve(newlen)) return false;
+	if (buffer && cstr >= buffer && cstr < buffer + len) {
+		// appending part of itself, the buffer may move
+		unsigned int offset = cstr - buffer;
+		if (!reserve(newlen)) return false;
+		cstr = buffer + offset;
+	} else if (!reserve(newlen)) return false;
 	memcpy(buffer + len, cstr, length);
 	len = newlen;
 	buffer[len] = '\0';
@@ -41,6 +41,12 @@ namespace arduino {
 //     -felide-constructors
 //     -std=c++0x
 
+// Strings up to STRING_INLINE_SIZE - 1 characters are kept inside the object
+// and need no heap allocation.
+#ifndef STRING_INLINE_SIZE
+#define STRING_INLINE_SIZE 12
+#endif
+
 class __FlashStringHelper;
 #define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
 
@@ -219,10 +225,13 @@ protected:
 	char *buffer;	        // the actual char array
 	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
+	char inlineBuffer[STRING_INLINE_SIZE];  // buffer points here for short strings
 protected:
 	void init(void);
 	void invalidate(void);
 	bool changeBuffer(unsigned int maxStrLen);
+	bool isInline(void) const { return buffer == inlineBuffer; }
+	void release(void);
 
 	// copy and move
 	String & copy(const char *cstr, unsigned int length);
@@ -0,0 +1,182 @@
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+// vendor driver headers have no c++ guards
+extern "C" {
+#include "mem_pub.h"
+extern void vApplicationMallocFailedHook(void);
+}
+
+/*
+ * Global new and delete. Objects go straight to the heap instead of through
+ * the wrapped malloc(), so the heap telemetry sees the code that did the new.
+ * Small objects are served by the slab classes of mem_slab.c (up to 96 bytes
+ * with the default table), larger ones by the main heap. The compiler takes
+ * the throwing forms to never return NULL, so they call the malloc failed
+ * hook and abort like libstdc++ does; only the nothrow forms return NULL.
+ */
+
+// heap blocks are 8 byte aligned, more than that is done by hand
+#define NEW_ALIGN_MIN       8
+
+#if !defined(__cpp_aligned_new)
+// the core builds as c++11 where <new> leaves this out, the definition is
+// the one of libstdc++ so code built as c++17 links against the operators below
+namespace std {
+enum class align_val_t : size_t {};
+}
+#endif
+
+// inlined so the return address is the caller of operator new
+static inline __attribute__((always_inline)) void *__newAlloc(size_t size)
+{
+    return pvPortMallocHeap(size, OS_HEAP_MAIN, __builtin_return_address(0), 0);
+}
+
+// the block taken from the heap is kept in the word before the object
+static inline __attribute__((always_inline)) void *__newAllocAligned(size_t size, size_t align)
+{
+    uint8_t *raw = NULL;
+    uintptr_t obj = 0;
+
+    if (align <= NEW_ALIGN_MIN) {
+        return __newAlloc(size);
+    }
+
+    raw = (uint8_t *)pvPortMallocHeap(size + align + sizeof(void *), OS_HEAP_MAIN, __builtin_return_address(0), 0);
+    if (raw == NULL) {
+        return NULL;
+    }
+
+    obj = ((uintptr_t)raw + sizeof(void *) + align - 1) & ~(uintptr_t)(align - 1);
+    ((void **)obj)[-1] = raw;
+
+    return (void *)obj;
+}
+
+static inline void *__newCheck(void *ptr)
+{
+    if (ptr == NULL) {
+        vApplicationMallocFailedHook();
+        abort();
+    }
+
+    return ptr;
+}
+
+static void __newFreeAligned(void *ptr, size_t align)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    if (align <= NEW_ALIGN_MIN) {
+        vPortFree(ptr);
+    } else {
+        vPortFree(((void **)ptr)[-1]);
+    }
+}
+
+void *operator new(size_t size)
+{
+    return __newCheck(__newAlloc(size));
+}
+
+void *operator new[](size_t size)
+{
+    return __newCheck(__newAlloc(size));
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return __newAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return __newAlloc(size);
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+    return __newCheck(__newAllocAligned(size, (size_t)align));
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+    return __newCheck(__newAllocAligned(size, (size_t)align));
+}
+
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return __newAllocAligned(size, (size_t)align);
+}
+
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return __newAllocAligned(size, (size_t)align);
+}
+
+// the heap finds the slab class or block from the pointer, the size is not needed
+void operator delete(void *ptr) noexcept
+{
+    vPortFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    vPortFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    vPortFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    vPortFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    vPortFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    vPortFree(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t align) noexcept
+{
+    __newFreeAligned(ptr, (size_t)align);
+}
+
+void operator delete[](void *ptr, std::align_val_t align) noexcept
+{
+    __newFreeAligned(ptr, (size_t)align);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t align) noexcept
+{
+    __newFreeAligned(ptr, (size_t)align);
+}
+
+void operator delete[](void *ptr, size_t, std::align_val_t align) noexcept
+{
+    __newFreeAligned(ptr, (size_t)align);
+}
+
+void operator delete(void *ptr, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    __newFreeAligned(ptr, (size_t)align);
+}
+
+void operator delete[](void *ptr, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    __newFreeAligned(ptr, (size_t)align);
+}
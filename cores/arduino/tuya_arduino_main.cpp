@@ -1,13 +1,22 @@
 #include "Arduino.h"
+#include "wiring_private.h"
 
 #include "tuya_cloud_types.h"
 #include "tuya_iot_com_api.h"
 #include "tuya_cloud_wifi_defs.h"
 #include "tal_thread.h"
 #include "tal_system.h"
+#include "tal_semaphore.h"
 #include "tal_log.h"
 #include "tkl_uart.h"
 
+#include "FreeRTOS.h"
+#include "task.h"
+// vendor driver headers have no c++ guards
+extern "C" {
+#include "rtos_pub.h"
+}
+
 #if defined(ENABLE_LWIP) && (ENABLE_LWIP == 1)
 #include "lwip_init.h"
 #endif
@@ -19,13 +28,169 @@ extern "C"{
 STATIC THREAD_HANDLE ty_app_thread = NULL;
 STATIC THREAD_HANDLE arduino_thrd_hdl = NULL;
 
+STATIC volatile LoopMode __loopMode = LOOP_MODE_TICK;
+STATIC volatile uint32_t __loopPeriodMs = 0;
+STATIC SEM_HANDLE __loopEventSem = NULL;
+
+STATIC LoopStats __loopStats = {0};
+STATIC uint64_t __loopPeriodSum = 0;
+STATIC uint64_t __loopJitterSum = 0;
+STATIC bool __loopStarted = false;
+STATIC uint32_t __loopLastStart = 0;
+STATIC uint32_t __loopLastPeriod = 0;
+
+STATIC void __loopStatsUpdate(uint32_t start)
+{
+    uint32_t period = start - __loopLastStart;
+    uint32_t diff = 0;
+
+    portENTER_CRITICAL();
+    if (__loopStarted) {
+        if (__loopStats.iterations == 0 || period < __loopStats.minPeriodUs) {
+            __loopStats.minPeriodUs = period;
+        }
+        if (period > __loopStats.maxPeriodUs) {
+            __loopStats.maxPeriodUs = period;
+        }
+        __loopPeriodSum += period;
+        if (__loopStats.iterations > 0) {
+            diff = (period > __loopLastPeriod) ? (period - __loopLastPeriod) : (__loopLastPeriod - period);
+            __loopJitterSum += diff;
+        }
+        __loopStats.iterations++;
+        __loopLastPeriod = period;
+    }
+    __loopLastStart = start;
+    __loopStarted = true;
+    portEXIT_CRITICAL();
+
+    return;
+}
+
+void setLoopMode(LoopMode mode, uint32_t periodMs)
+{
+    if ((mode == LOOP_MODE_FIXED_RATE) && (periodMs == 0)) {
+        return;
+    }
+
+    __loopPeriodMs = periodMs;
+    __loopMode = mode;
+
+    // let a waiting event loop pick up the new mode
+    loopSignal();
+
+    return;
+}
+
+LoopMode getLoopMode(void)
+{
+    return __loopMode;
+}
+
+void loopSignal(void)
+{
+    if (__loopEventSem != NULL) {
+        tal_semaphore_post(__loopEventSem);
+    }
+
+    return;
+}
+
+void getLoopStats(LoopStats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL();
+    *stats = __loopStats;
+    if (__loopStats.iterations > 0) {
+        stats->avgPeriodUs = (uint32_t)(__loopPeriodSum / __loopStats.iterations);
+    }
+    if (__loopStats.iterations > 1) {
+        stats->jitterUs = (uint32_t)(__loopJitterSum / (__loopStats.iterations - 1));
+    }
+    portEXIT_CRITICAL();
+
+    return;
+}
+
+void resetLoopStats(void)
+{
+    portENTER_CRITICAL();
+    memset(&__loopStats, 0, sizeof(__loopStats));
+    __loopPeriodSum = 0;
+    __loopJitterSum = 0;
+    __loopStarted = false;
+    __loopLastPeriod = 0;
+    portEXIT_CRITICAL();
+
+    return;
+}
+
+float getCpuLoad(bool tenSeconds)
+{
+    rtos_cpu_load_t load;
+
+    if (kNoErr != rtos_get_cpu_load(&load)) {
+        return 0.0f;
+    }
+
+    return (tenSeconds ? load.load_10s : load.load_1s) / 10.0f;
+}
+
 STATIC void arduino_thread(void *arg)
 {
+    TickType_t wake = 0;
+    TickType_t period = 0;
+    TickType_t now = 0;
+    LoopMode mode = LOOP_MODE_TICK;
+    LoopMode lastMode = LOOP_MODE_TICK;
+
+    tal_semaphore_create_init(&__loopEventSem, 0, 1);
+
+    delayMicrosecondsCalibrate();
+    rtos_cpu_load_start();
+
     setup();
 
     for (;;) {
+        mode = __loopMode;
+        if (mode != lastMode) {
+            // fixed rate starts counting from the first loop() in that mode
+            wake = xTaskGetTickCount();
+            lastMode = mode;
+        }
+
+        __loopStatsUpdate((uint32_t)micros());
         loop();
-        tal_system_sleep(1);
+
+        switch (mode) {
+            case LOOP_MODE_FREE_RUN: {
+                taskYIELD();
+            } break;
+            case LOOP_MODE_FIXED_RATE: {
+                period = pdMS_TO_TICKS(__loopPeriodMs);
+                if (period == 0) {
+                    period = 1;
+                }
+                now = xTaskGetTickCount();
+                if ((TickType_t)(now - wake) >= period) {
+                    // loop() ran past its slot, restart the schedule instead of bursting to catch up
+                    __loopStats.overruns++;
+                    wake = now;
+                    taskYIELD();
+                } else {
+                    vTaskDelayUntil(&wake, period);
+                }
+            } break;
+            case LOOP_MODE_EVENT: {
+                tal_semaphore_wait(__loopEventSem, (__loopPeriodMs == 0) ? SEM_WAIT_FOREVER : __loopPeriodMs);
+            } break;
+            default: {
+                tal_system_sleep(1);
+            } break;
+        }
     }
 
     return;
@@ -2,6 +2,98 @@
 
 #include "FreeRTOS.h"
 #include "portmacro.h"
+#include "task.h"
+
+extern "C" {
+#include "fake_clock_pub.h"
+}
+
+#include "wiring_private.h"
+
+// spin loops timed against micros() to calibrate delayMicroseconds(), a few ms
+#define DELAY_CAL_LOOPS     100000
+#define DELAY_CAL_ROUNDS    3
+
+#define DELAY_TICK_US       (portTICK_PERIOD_MS * 1000)
+// what is left of a delay() below this is spun instead of sleeping a whole tick
+#define DELAY_SPIN_US       50
+
+#define MICROS_COUNT_PER_US (configRUN_TIME_COUNTER_HZ / 1000000)
+
+// spin loops per ms, 0 until calibrated
+static volatile uint32_t __delayLoopsPerMs = 0;
+
+#if configGENERATE_RUN_TIME_STATS
+// phase of the 26MHz counter against fclk, in counts, set on first use
+static volatile uint32_t __microsPhase = 0;
+static volatile bool __microsSynced = false;
+
+/*
+ * fclk_get_us() moves in ~31us steps, the run time stats counter in 1/26us
+ * but wraps every 165s. fclk says which wrap the counter is in, the counter
+ * gives the us within it, so the two only have to agree to within 80s.
+ */
+static uint64_t __microsRead(void)
+{
+    uint64_t coarse = 0;
+    uint32_t count = 0;
+
+    // the counter starts with the scheduler
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return fclk_get_us();
+    }
+
+    count = bk_timer_runtime_read();
+    coarse = fclk_get_us() * MICROS_COUNT_PER_US;
+    if (!__microsSynced) {
+        __microsPhase = (uint32_t)coarse - count;
+        __asm__ __volatile__("" ::: "memory");
+        __microsSynced = true;
+    }
+
+    coarse -= __microsPhase;
+    coarse += (int32_t)(count - (uint32_t)coarse);
+
+    return (coarse + __microsPhase) / MICROS_COUNT_PER_US;
+}
+#else
+static uint64_t __microsRead(void)
+{
+    return fclk_get_us();
+}
+#endif
+
+static void __attribute__((noinline)) __delaySpin(uint32_t loops)
+{
+    while (loops--) {
+        __asm__ __volatile__("nop");
+    }
+}
+
+void delayMicrosecondsCalibrate(void)
+{
+    uint64_t start = 0;
+    uint64_t took = 0;
+    uint64_t best = 0;
+    uint8_t i;
+
+    // the fastest round is the one that was not preempted
+    for (i = 0; i < DELAY_CAL_ROUNDS; i++) {
+        start = micros64();
+        __delaySpin(DELAY_CAL_LOOPS);
+        took = micros64() - start;
+        if (took > 0 && (best == 0 || took < best)) {
+            best = took;
+        }
+    }
+
+    if (best == 0) {
+        best = 1;
+    }
+    __delayLoopsPerMs = (uint32_t)((uint64_t)DELAY_CAL_LOOPS * 1000 / best);
+
+    return;
+}
 
 #ifdef __cplusplus
 extern "C"{
@@ -13,9 +105,56 @@ unsigned long millis()
     return ms;
 }
 
+unsigned long micros(void)
+{
+    return (unsigned long)__microsRead();
+}
+
+uint64_t micros64(void)
+{
+    return __microsRead();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    if (us == 0) {
+        return;
+    }
+
+    if (__delayLoopsPerMs == 0) {
+        delayMicrosecondsCalibrate();
+    }
+
+    __delaySpin((uint32_t)((uint64_t)us * __delayLoopsPerMs / 1000));
+
+    return;
+}
+
+// sleep in ticks rounded up, only the last few us are spun
 void delay(unsigned long ms)
 {
-    return tal_system_sleep((UINT_T)ms);
+    uint64_t deadline = 0;
+    uint64_t now = 0;
+
+    if (ms == 0) {
+        return tal_system_sleep(0);
+    }
+
+    deadline = micros64() + (uint64_t)ms * 1000;
+
+    for (;;) {
+        now = micros64();
+        if (now + DELAY_SPIN_US >= deadline) {
+            break;
+        }
+        // the first tick of vTaskDelay() may be partial, the loop sleeps again if it was short
+        vTaskDelay((TickType_t)((deadline - now + DELAY_TICK_US - 1) / DELAY_TICK_US));
+    }
+
+    while (micros64() < deadline) {
+    }
+
+    return;
 }
 
 void yield(void)
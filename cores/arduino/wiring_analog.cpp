@@ -1,73 +1,52 @@
 #include "Arduino.h"
+#include "wiring_private.h"
 
 #include "tkl_adc.h"
 #include "tkl_pwm.h"
 
+static bool __adcReady = false;
+
+int analogPinToChannel(pin_size_t pinNumber)
+{
+    switch (pinNumber) {
+        case p22: return 4;
+        case p23: return 2;
+        case p24: return 1;
+        case p26: return 0;
+        case p28: return 3;
+        default : return -1;
+    }
+}
+
 int analogRead(pin_size_t pinNumber)
 {
     int readValue = 0;
-    UINT8_T chanList = 0;
+    int channel = analogPinToChannel(pinNumber);
 
-    TUYA_ADC_NUM_E adcId;
-    TUYA_ADC_BASE_CFG_T adcCfg;
+    if (channel < 0) {
+        return 0;
+    }
 
-    switch (pinNumber) {
-        case p22: {
-            adcId = ADC_NUM_0;
-            chanList = 4; // channel 4
-            adcCfg.ch_list = &chanList;
-            adcCfg.ch_nums = 1;
-            adcCfg.width = 12;
-            adcCfg.mode = TUYA_ADC_CONTINUOUS;
-            adcCfg.type = TUYA_ADC_INNER_SAMPLE_VOL;
-            adcCfg.conv_cnt = 1;
-        } break;
-        case p23: {
-            adcId = ADC_NUM_0;
-            chanList = 2;
-            adcCfg.ch_list = &chanList;
-            adcCfg.ch_nums = 1;
-            adcCfg.width = 12;
-            adcCfg.mode = TUYA_ADC_CONTINUOUS;
-            adcCfg.type = TUYA_ADC_INNER_SAMPLE_VOL;
-            adcCfg.conv_cnt = 1;
-        } break;
-        case p24: {
-            adcId = ADC_NUM_0;
-            chanList = 1;
-            adcCfg.ch_list = &chanList;
-            adcCfg.ch_nums = 1;
-            adcCfg.width = 12;
-            adcCfg.mode = TUYA_ADC_CONTINUOUS;
-            adcCfg.type = TUYA_ADC_INNER_SAMPLE_VOL;
-            adcCfg.conv_cnt = 1;
-        } break;
-        case p26: {
-            adcId = ADC_NUM_0;
-            chanList = 0;
-            adcCfg.ch_list = &chanList;
-            adcCfg.ch_nums = 1;
-            adcCfg.width = 12;
-            adcCfg.mode = TUYA_ADC_CONTINUOUS;
-            adcCfg.type = TUYA_ADC_INNER_SAMPLE_VOL;
-            adcCfg.conv_cnt = 1;
-        } break;
-        case p28: {
-            adcId = ADC_NUM_0;
-            chanList = 3;
-            adcCfg.ch_list = &chanList;
-            adcCfg.ch_nums = 1;
-            adcCfg.width = 12;
-            adcCfg.mode = TUYA_ADC_CONTINUOUS;
-            adcCfg.type = TUYA_ADC_INNER_SAMPLE_VOL;
-            adcCfg.conv_cnt = 1;
-        } break;
-        default : return 0;
+    // a running sampler owns the saradc, hand out its latest value or 0
+    if (analogSamplerLatest(channel, &readValue)) {
+        return readValue;
     }
 
-    tkl_adc_init(adcId, &adcCfg);
+    // every adc pin is enabled at once, so the config is only set up on the first read
+    if (!__adcReady) {
+        static UINT8_T chanList[] = {0, 1, 2, 3, 4};
+        TUYA_ADC_BASE_CFG_T adcCfg;
+
+        adcCfg.ch_list = chanList;
+        adcCfg.ch_nums = sizeof(chanList);
+        adcCfg.width = 12;
+        adcCfg.mode = TUYA_ADC_CONTINUOUS;
+        adcCfg.type = TUYA_ADC_INNER_SAMPLE_VOL;
+        adcCfg.conv_cnt = 1;
+        __adcReady = (OPRT_OK == tkl_adc_init(ADC_NUM_0, &adcCfg));
+    }
 
-    tkl_adc_read_single_channel(adcId, chanList, &readValue);
+    tkl_adc_read_single_channel(ADC_NUM_0, channel, &readValue);
 
     return readValue;
 }
@@ -78,40 +57,120 @@ void analogReference(uint8_t mode)
 }
 
 #define DEFAULT_PWM_FREQ    1000
+#define PWM_DUTY_MAX        10000   // tuya duty 0-10000
+
+static uint32_t __pwmFrequency = DEFAULT_PWM_FREQ;
+// full scale of analogWrite() values, 0-100 until analogWriteResolution() is called
+static uint32_t __pwmRange = 100;
+// channels started by analogWrite()
+static uint8_t __pwmRunning = 0;
+
+static TUYA_PWM_NUM_E __pinToPwm(pin_size_t pinNumber)
+{
+    switch (pinNumber) {
+        case p6:  return PWM_NUM_0;
+        case p7:  return PWM_NUM_1;
+        case p8:  return PWM_NUM_2;
+        case p9:  return PWM_NUM_3;
+        case p24: return PWM_NUM_4;
+        case p26: return PWM_NUM_5;
+        default : return PWM_NUM_MAX;
+    }
+}
+
+static UINT32_T __valueToDuty(int value)
+{
+    if (value <= 0) {
+        return 0;
+    }
+    if ((uint32_t)value >= __pwmRange) {
+        return PWM_DUTY_MAX;
+    }
+
+    return (UINT32_T)((uint32_t)value * PWM_DUTY_MAX / __pwmRange);
+}
 
-// value: 0-100
 void analogWrite(pin_size_t pinNumber, int value)
 {
-    TUYA_PWM_NUM_E pwmNum = PWM_NUM_MAX;
+    TUYA_PWM_NUM_E pwmNum = __pinToPwm(pinNumber);
     TUYA_PWM_BASE_CFG_T pwmCfg;
 
-    switch (pinNumber) {
-        case p6: {
-            pwmNum = PWM_NUM_0;
-        } break;
-        case p7: {
-            pwmNum = PWM_NUM_1;
-        } break;
-        case p8: {
-            pwmNum = PWM_NUM_2;
-        } break;
-        case p9: {
-            pwmNum = PWM_NUM_3;
-        } break;
-        case p24: {
-            pwmNum = PWM_NUM_4;
-        } break;
-        case p26: {
-            pwmNum = PWM_NUM_5;
-        } break;
-        default : return;
+    if (pwmNum == PWM_NUM_MAX) {
+        return;
     }
 
-    pwmCfg.frequency = DEFAULT_PWM_FREQ;
+    pwmCfg.frequency = __pwmFrequency;
     pwmCfg.polarity = TUYA_PWM_NEGATIVE;
-    pwmCfg.duty = (value*100) % 10000; // tuya duty 0-10000
-    tkl_pwm_init(pwmNum, &pwmCfg);
-    tkl_pwm_start(pwmNum);
+    pwmCfg.duty = __valueToDuty(value);
+    tkl_pwm_info_set(pwmNum, &pwmCfg);
+
+    // a running channel only gets its duty register rewritten
+    if (OPRT_OK == tkl_pwm_start(pwmNum)) {
+        __pwmRunning |= (1 << pwmNum);
+    }
+
+    return;
+}
+
+void analogWriteFrequency(uint32_t frequency)
+{
+    uint8_t i;
+
+    if (frequency == 0 || frequency == __pwmFrequency) {
+        return;
+    }
+    __pwmFrequency = frequency;
+
+    // running channels move to the new period with their current duty
+    for (i = 0; i < PWM_NUM_MAX; i++) {
+        if (__pwmRunning & (1 << i)) {
+            tkl_pwm_frequency_set((TUYA_PWM_NUM_E)i, frequency);
+            tkl_pwm_start((TUYA_PWM_NUM_E)i);
+        }
+    }
+
+    return;
+}
+
+void analogWriteResolution(uint8_t bits)
+{
+    if (bits < 1 || bits > 16) {
+        return;
+    }
+
+    __pwmRange = (1UL << bits) - 1;
+
+    return;
+}
+
+void analogWriteGroup(const pin_size_t *pins, const int *values, uint8_t count)
+{
+    TUYA_PWM_NUM_E pwmNum[PWM_NUM_MAX];
+    TUYA_PWM_BASE_CFG_T pwmCfg;
+    uint8_t i;
+
+    if (pins == NULL || values == NULL || count == 0 || count > PWM_NUM_MAX) {
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        pwmNum[i] = __pinToPwm(pins[i]);
+        if (pwmNum[i] == PWM_NUM_MAX) {
+            return;
+        }
+
+        pwmCfg.frequency = __pwmFrequency;
+        pwmCfg.polarity = TUYA_PWM_NEGATIVE;
+        pwmCfg.duty = __valueToDuty(values[i]);
+        tkl_pwm_info_set(pwmNum[i], &pwmCfg);
+    }
+
+    // all duties switch at the same period boundary
+    if (OPRT_OK == tkl_pwm_group_start(pwmNum, count)) {
+        for (i = 0; i < count; i++) {
+            __pwmRunning |= (1 << pwmNum[i]);
+        }
+    }
 
     return;
 }
@@ -2,7 +2,21 @@
 
 #include "tkl_gpio.h"
 
-void pinMode(pin_size_t pinNumber, PinMode pinMode)
+#include "FreeRTOS.h"
+#include "portmacro.h"
+#include "arm_arch.h"
+#include "gpio.h"
+
+#define GPIO_PIN_MAX        32
+
+// level bit lives in each pin's config register, pins above 31 are not used on t2
+#define GPIO_CFG_REG(pin)   ((volatile UINT32 *)(REG_GPIO_CFG_BASE_ADDR + (pin) * 4))
+
+// pins set to OUTPUT or OUTPUT_OPENDRAIN by pinMode(), digitalWrite() skips the init for them
+static uint32_t __outputMask = 0;
+
+// outputs start at level, so a pin is never driven to another level on the way
+static void __pinMode(pin_size_t pinNumber, PinMode pinMode, TUYA_GPIO_LEVEL_E level)
 {
     TUYA_GPIO_BASE_CFG_T gpioCfg;
 
@@ -16,7 +30,7 @@ void pinMode(pin_size_t pinNumber, PinMode pinMode)
         case OUTPUT: {
             gpioCfg.direct = TUYA_GPIO_OUTPUT;
             gpioCfg.mode = TUYA_GPIO_PUSH_PULL;
-            gpioCfg.level = TUYA_GPIO_LEVEL_LOW;
+            gpioCfg.level = level;
         } break;
         case INPUT_PULLUP: {
             gpioCfg.direct = TUYA_GPIO_INPUT;
@@ -29,37 +43,47 @@ void pinMode(pin_size_t pinNumber, PinMode pinMode)
         case OUTPUT_OPENDRAIN:{
             gpioCfg.direct = TUYA_GPIO_OUTPUT;
             gpioCfg.mode = TUYA_GPIO_OPENDRAIN;
-            gpioCfg.level = TUYA_GPIO_LEVEL_LOW;
+            gpioCfg.level = level;
         } break;
         default : return;
     }
 
     tkl_gpio_init(tuyaPin, &gpioCfg);
 
+    if (pinNumber < GPIO_PIN_MAX) {
+        if (TUYA_GPIO_OUTPUT == gpioCfg.direct) {
+            __outputMask |= (1UL << pinNumber);
+        } else {
+            __outputMask &= ~(1UL << pinNumber);
+        }
+    }
+
     return;
 }
 
-void digitalWrite(pin_size_t pinNumber, PinStatus status)
+void pinMode(pin_size_t pinNumber, PinMode pinMode)
 {
-    TUYA_GPIO_BASE_CFG_T gpioCfg;
+    __pinMode(pinNumber, pinMode, TUYA_GPIO_LEVEL_LOW);
 
+    return;
+}
+
+void digitalWrite(pin_size_t pinNumber, PinStatus status)
+{
     TUYA_GPIO_NUM_E tuyaPin = (TUYA_GPIO_NUM_E)pinNumber;
+    TUYA_GPIO_LEVEL_E level = (status == HIGH) ? TUYA_GPIO_LEVEL_HIGH : TUYA_GPIO_LEVEL_LOW;
 
-    switch (status) {
-        case (LOW): {
-            gpioCfg.direct = TUYA_GPIO_OUTPUT;
-            gpioCfg.mode = TUYA_GPIO_PUSH_PULL;
-            gpioCfg.level = TUYA_GPIO_LEVEL_LOW;
-        } break;
-        case (HIGH): {
-            gpioCfg.direct = TUYA_GPIO_OUTPUT;
-            gpioCfg.mode = TUYA_GPIO_PUSH_PULL;
-            gpioCfg.level = TUYA_GPIO_LEVEL_HIGH;
-        } break;
-        default: return;
+    if ((status != LOW) && (status != HIGH)) {
+        return;
     }
 
-    tkl_gpio_init(tuyaPin, &gpioCfg);
+    // an unconfigured pin is switched to output once, like before, already at the level
+    if ((pinNumber >= GPIO_PIN_MAX) || !(__outputMask & (1UL << pinNumber))) {
+        __pinMode(pinNumber, OUTPUT, level);
+        return;
+    }
+
+    tkl_gpio_write(tuyaPin, level);
 
     return;
 }
@@ -73,3 +97,57 @@ PinStatus digitalRead(pin_size_t pinNumber)
 
     return ((level==TUYA_GPIO_LEVEL_HIGH) ? (HIGH) : (LOW));
 }
+
+void digitalWriteFast(pin_size_t pinNumber, PinStatus status)
+{
+    UINT32 reg;
+
+    if (pinNumber >= GPIO_PIN_MAX) {
+        return;
+    }
+
+    reg = REG_READ(GPIO_CFG_REG(pinNumber));
+    if (status == HIGH) {
+        reg |= GCFG_OUTPUT_BIT;
+    } else {
+        reg &= ~GCFG_OUTPUT_BIT;
+    }
+    REG_WRITE(GPIO_CFG_REG(pinNumber), reg);
+
+    return;
+}
+
+PinStatus digitalReadFast(pin_size_t pinNumber)
+{
+    if (pinNumber >= GPIO_PIN_MAX) {
+        return LOW;
+    }
+
+    return (REG_READ(GPIO_CFG_REG(pinNumber)) & GCFG_INPUT_BIT) ? HIGH : LOW;
+}
+
+void portWrite(uint32_t mask, uint32_t value)
+{
+    UINT32 reg;
+    uint32_t pin;
+    uint32_t pins = mask & __outputMask;
+
+    // every pin has its own register, so update them back to back with
+    // interrupts off to keep the edges together
+    portENTER_CRITICAL();
+    for (pin = 0; pins != 0; pin++, pins >>= 1) {
+        if (!(pins & 1)) {
+            continue;
+        }
+        reg = REG_READ(GPIO_CFG_REG(pin));
+        if (value & (1UL << pin)) {
+            reg |= GCFG_OUTPUT_BIT;
+        } else {
+            reg &= ~GCFG_OUTPUT_BIT;
+        }
+        REG_WRITE(GPIO_CFG_REG(pin), reg);
+    }
+    portEXIT_CRITICAL();
+
+    return;
+}
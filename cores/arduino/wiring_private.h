@@ -0,0 +1,16 @@
+#ifndef WIRING_PRIVATE_H
+#define WIRING_PRIVATE_H
+
+#include "Arduino.h"
+
+// saradc channel wired to an analog pin, -1 if the pin has no adc
+int analogPinToChannel(pin_size_t pinNumber);
+
+// latest value of a channel scanned by the running AnalogSampler, 0 for a channel
+// it does not scan; false if no sampler runs
+bool analogSamplerLatest(int channel, int *value);
+
+// time the delayMicroseconds() spin loop against micros(), runs once before setup()
+void delayMicrosecondsCalibrate(void);
+
+#endif // WIRING_PRIVATE_H
@@ -1,32 +1,103 @@
 #include "Arduino.h"
 
+#include "SPI.h"
+
+#ifndef SHIFT_SPI_FREQ
+#define SHIFT_SPI_FREQ      4000000
+#endif
+
+static bool __shiftSpiUsed = false;
+
+// hand the spi pins back to gpio before bit-banging on them
+static void __shiftSpiEnd(pin_size_t dataPin, pin_size_t clockPin)
+{
+    if (!__shiftSpiUsed) {
+        return;
+    }
+
+    if (dataPin != SPI_MOSI_PIN && dataPin != SPI_SCK_PIN &&
+        clockPin != SPI_MOSI_PIN && clockPin != SPI_SCK_PIN) {
+        return;
+    }
+
+    SPI.end();
+    __shiftSpiUsed = false;
+
+    pinMode(SPI_SCK_PIN, OUTPUT);
+    pinMode(SPI_MOSI_PIN, OUTPUT);
+}
+
+static void __shiftOutByte(pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOrder, uint8_t val)
+{
+    uint8_t i;
+
+    for (i = 0; i < 8; i++)  {
+        if (bitOrder == LSBFIRST)
+            digitalWriteFast(dataPin, !!(val & (1 << i)) ? HIGH : LOW);
+        else
+            digitalWriteFast(dataPin, !!(val & (1 << (7 - i))) ? HIGH : LOW);
+
+        digitalWriteFast(clockPin, HIGH);
+        digitalWriteFast(clockPin, LOW);
+    }
+}
+
 uint8_t shiftIn(pin_size_t dataPin, uint8_t clockPin, BitOrder bitOrder)
 {
     uint8_t value = 0;
     uint8_t i;
 
+    __shiftSpiEnd(dataPin, clockPin);
+
+    // configures the clock pin once, the loop then only touches registers
+    digitalWrite(clockPin, LOW);
+
     for (i = 0; i < 8; ++i) {
-        digitalWrite(clockPin, HIGH);
+        digitalWriteFast(clockPin, HIGH);
         if (bitOrder == LSBFIRST)
-            value |= digitalRead(dataPin) << i;
+            value |= digitalReadFast(dataPin) << i;
         else
-            value |= digitalRead(dataPin) << (7 - i);
-        digitalWrite(clockPin, LOW);
+            value |= digitalReadFast(dataPin) << (7 - i);
+        digitalWriteFast(clockPin, LOW);
     }
     return value;
 }
 
 void shiftOut(pin_size_t dataPin, uint8_t clockPin, BitOrder bitOrder, uint8_t val)
 {
-    uint8_t i;
+    __shiftSpiEnd(dataPin, clockPin);
 
-    for (i = 0; i < 8; i++)  {
-        if (bitOrder == LSBFIRST)
-            digitalWrite(dataPin, !!(val & (1 << i)) ? HIGH : LOW);
-        else	
-            digitalWrite(dataPin, !!(val & (1 << (7 - i))) ? HIGH : LOW);
-            
-        digitalWrite(clockPin, HIGH);
-        digitalWrite(clockPin, LOW);
+    // configures both pins once, the loop then only touches registers
+    digitalWrite(clockPin, LOW);
+    digitalWrite(dataPin, LOW);
+
+    __shiftOutByte(dataPin, clockPin, bitOrder, val);
+}
+
+void shiftOutBuffer(pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOrder, const uint8_t *buf, size_t len)
+{
+    size_t i;
+
+    if (buf == NULL || len == 0) {
+        return;
+    }
+
+    // the spi engine clocks the whole buffer out by dma
+    if (dataPin == SPI_MOSI_PIN && clockPin == SPI_SCK_PIN) {
+        SPI.begin();
+        __shiftSpiUsed = true;
+        SPI.beginTransaction(SPISettings(SHIFT_SPI_FREQ, bitOrder, SPI_MODE0));
+        SPI.writeBytes(buf, len);
+        SPI.endTransaction();
+        return;
+    }
+
+    __shiftSpiEnd(dataPin, clockPin);
+
+    digitalWrite(clockPin, LOW);
+    digitalWrite(dataPin, LOW);
+
+    for (i = 0; i < len; i++) {
+        __shiftOutByte(dataPin, clockPin, bitOrder, buf[i]);
     }
 }
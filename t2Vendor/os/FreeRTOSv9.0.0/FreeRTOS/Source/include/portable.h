@@ -171,6 +171,14 @@ void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions ) PRIVILEG
  */
 void *pvPortCalloc( size_t nmemb, size_t size ) PRIVILEGED_FUNCTION;
 void *pvPortRealloc( void *pv, size_t size ) PRIVILEGED_FUNCTION;
+/* pvSite is the caller address (xLine 0) or a function name, for the heap telemetry */
+void *pvPortMallocTrace( size_t xWantedSize, const void *pvSite, int xLine ) PRIVILEGED_FUNCTION;
+/* ulFlags is an OS_HEAP_ selection from mem_pub.h */
+void *pvPortMallocHeap( size_t xWantedSize, uint32_t ulFlags, const void *pvSite, int xLine ) PRIVILEGED_FUNCTION;
+/* bytes usable in a block, 0 when the heap does not know */
+size_t xPortGetUsableSize( void *pv ) PRIVILEGED_FUNCTION;
+/* one step of the heap integrity check, called from the idle hook */
+void vPortHeapCheckIdle( void ) PRIVILEGED_FUNCTION;
 #if OSMALLOC_STATISTICAL
 void *pvPortMalloc_cm(const char *call_func_name, int line, size_t xWantedSize, int need_zero) PRIVILEGED_FUNCTION;
 void *vPortFree_cm(const char *call_func_name, int line, void *pv ) PRIVILEGED_FUNCTION;
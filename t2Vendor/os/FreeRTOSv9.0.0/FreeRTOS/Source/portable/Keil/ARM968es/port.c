@@ -83,6 +83,8 @@
 #include "rw_pub.h"
 #include "fake_clock_pub.h"
 #include "power_save_pub.h"
+#include "mcu_ps_pub.h"
+#include "task.h"
 
 #if (NX_POWERSAVE)
 #include "ps.h"
@@ -123,6 +125,11 @@ from an asm wrapper function. */
 	static uint16_t s_nPulseLength;
 #endif
 
+#if ( configUSE_TICKLESS_IDLE != 0 )
+	/* Counters of vPortSuppressTicksAndSleep(), see vPortGetSleepStats(). */
+	static PortSleepStats_t xSleepStats;
+#endif
+
 /*-----------------------------------------------------------*/
 extern void bk_ir_background_check_timer(void);
 
@@ -145,6 +152,8 @@ void vApplicationIdleHook( void )
 	{
 		(*func_irda_bg_check)();
 	}
+
+	vPortHeapCheckIdle();
 }
 
 /*-----------------------------------------------------------*/
@@ -369,6 +378,80 @@ void vPortExitCritical( void )
 	}
 }
 
+/*-----------------------------------------------------------*/
+#if ( configUSE_TICKLESS_IDLE != 0 )
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+UINT64 ullStart, ullSlept;
+UINT32 ulMissedTicks;
+GLOBAL_INT_DECLARATION();
+
+	/* Called by the idle task with the scheduler suspended.  mcu_power_save()
+	decides whether the mcu may sleep at all (mcu ps enabled, no peripheral
+	busy, wifi between two DTIM beacons) and programs timer3 as the wakeup
+	timer. */
+	if( xExpectedIdleTime > portMAX_SLEEP_TICKS )
+	{
+		xExpectedIdleTime = portMAX_SLEEP_TICKS;
+	}
+
+	GLOBAL_INT_DISABLE();
+	xSleepStats.ulAttempts++;
+
+	/* An interrupt between the idle task reading the expected idle time and
+	here may have readied a task or pended a yield, sleeping now would leave
+	that task waiting for the wakeup timer. */
+	if( eTaskConfirmSleepModeStatus() == eAbortSleep )
+	{
+		xSleepStats.ulAborts++;
+		GLOBAL_INT_RESTORE();
+		return;
+	}
+
+	ullStart = fclk_get_tick();
+	ulMissedTicks = mcu_power_save( xExpectedIdleTime );
+	fclk_update_tick( ulMissedTicks );
+
+	/* The tick is either stepped above or, when the mac hw timer is the
+	reference, already stepped by mcu_power_save(). */
+	ullSlept = fclk_get_tick() - ullStart;
+	if( ullSlept != 0 )
+	{
+		xSleepStats.ulSleeps++;
+		xSleepStats.ullExpectedTicks += xExpectedIdleTime;
+		xSleepStats.ullSleptTicks += ullSlept;
+
+		if( ullSlept > xExpectedIdleTime )
+		{
+			xSleepStats.ulLate++;
+			if( ( ullSlept - xExpectedIdleTime ) > xSleepStats.ulMaxLateTicks )
+			{
+				xSleepStats.ulMaxLateTicks = ( uint32_t ) ( ullSlept - xExpectedIdleTime );
+			}
+		}
+		else if( ullSlept + 1 < xExpectedIdleTime )
+		{
+			/* The wakeup timer fires one tick early, anything before that was
+			another interrupt. */
+			xSleepStats.ulEarly++;
+		}
+	}
+	GLOBAL_INT_RESTORE();
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetSleepStats( PortSleepStats_t *pxStats )
+{
+GLOBAL_INT_DECLARATION();
+
+	GLOBAL_INT_DISABLE();
+	*pxStats = xSleepStats;
+	GLOBAL_INT_RESTORE();
+}
+
+#endif /* configUSE_TICKLESS_IDLE */
+
 /*-----------------------------------------------------------*/
 uint32_t test_get_spsr( void )
 {    
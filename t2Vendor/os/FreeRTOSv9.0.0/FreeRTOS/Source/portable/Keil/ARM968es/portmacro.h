@@ -239,6 +239,28 @@ extern void vTaskSwitchContext( void ); 			\
 	}												\
 }
 
+/* Tickless idle. */
+/* Longest sleep asked from mcu_power_save().  Tasks blocked on
+portMAX_DELAY would overflow the tick to ms conversion, and the mac hw
+timer calibration drops a step of more than 50 s. */
+#define portMAX_SLEEP_TICKS		( ( TickType_t ) ( 30000 / portTICK_PERIOD_MS ) )
+
+typedef struct xPORT_SLEEP_STATS
+{
+	uint32_t ulAttempts;		/* The idle task asked for a tickless sleep. */
+	uint32_t ulAborts;			/* A task got ready before interrupts were off. */
+	uint32_t ulSleeps;			/* The tick was stepped, the rest were refused by mcu ps. */
+	uint32_t ulEarly;			/* Woken by an interrupt before the expected idle time. */
+	uint32_t ulLate;			/* Woken after the expected idle time. */
+	uint32_t ulMaxLateTicks;
+	uint64_t ullExpectedTicks;	/* Sum of the expected idle time of the sleeps. */
+	uint64_t ullSleptTicks;		/* Sum of the ticks stepped after the sleeps. */
+} PortSleepStats_t;
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+void vPortGetSleepStats( PortSleepStats_t *pxStats );
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+
 /* Task function macros as described on the FreeRTOS.org WEB site. */
 #define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void * pvParameters )
 #define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void * pvParameters )
@@ -79,6 +79,7 @@
 #include "mem_pub.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 /* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
 all the API functions to use the MPU wrappers.  That should only be done when
@@ -95,8 +96,179 @@ task.h is included from an application file. */
 #endif
 
 #include "tuya_mem_heap.h"
-static HEAP_HANDLE s_heap_handle = NULL;
-static HEAP_HANDLE s_heap_tss_handle = NULL;
+#include "heap_tlsf.h"
+#include "fake_clock_pub.h"
+
+/*
+ * Heap backend. The tuya heap walks its free lists, so the time it takes
+ * grows with fragmentation; the TLSF heap in heap_tlsf.c takes bounded time
+ * for malloc and free. Both have the same interface.
+ */
+#ifndef configHEAP_TLSF
+#define configHEAP_TLSF         0
+#endif
+
+#if configHEAP_TLSF
+#define heap_backend_init       tlsf_heap_init
+#define heap_backend_create     tlsf_heap_create
+#define heap_backend_malloc     tlsf_heap_malloc
+#define heap_backend_realloc    tlsf_heap_realloc
+#define heap_backend_free       tlsf_heap_free
+#define heap_backend_available  tlsf_heap_available
+#else
+#define heap_backend_init       tuya_mem_heap_init
+#define heap_backend_create     tuya_mem_heap_create
+#define heap_backend_malloc     tuya_mem_heap_malloc
+#define heap_backend_realloc    tuya_mem_heap_realloc
+#define heap_backend_free       tuya_mem_heap_free
+#define heap_backend_available  tuya_mem_heap_available
+#endif
+
+/*
+ * Heap telemetry. Every block carries a small header with the requested size
+ * and the call site, so frees can be accounted without asking the heap.
+ * Set configHEAP_TELEMETRY to 0 to drop the header and the per-site table.
+ */
+#ifndef configHEAP_TELEMETRY
+#define configHEAP_TELEMETRY    1
+#endif
+
+/*
+ * OS_HEAP_FAST requests fall back to the main heap unless OS_HEAP_NO_SPILL is
+ * given. Setting configHEAP_MAIN_SPILL lets main heap allocations fall back
+ * to the tcm heap too. It is off since any os_malloc() may be a pbuf or msdu
+ * buffer, and the linker script keeps the dma descriptors and lwIP pools out
+ * of tcm; only set it when no main heap block is handed to dma.
+ */
+#ifndef configHEAP_MAIN_SPILL
+#define configHEAP_MAIN_SPILL   0
+#endif
+
+/*
+ * Allocation trace. When started, every malloc, free and realloc is written
+ * to a ring of configHEAP_TRACE_NUM records that is drained with
+ * os_heap_trace_read() or printed by os_heap_trace_dump(). Records that do
+ * not fit are counted as lost, the ring is never overwritten. Blocks of
+ * os_pool_create() pools are recorded too. tools/heap_replay replays a dump
+ * against heap_4.c and heap_tlsf.c on the host.
+ */
+#ifndef configHEAP_TRACE
+#define configHEAP_TRACE        0
+#endif
+
+#ifndef configHEAP_TRACE_NUM
+#define configHEAP_TRACE_NUM    256
+#endif
+
+/*
+ * Per task accounting. Each block records the task that allocated it, and a
+ * task can be given a soft limit (counted when crossed) and a hard limit
+ * (allocations beyond it fail). Needs the telemetry header. Slab blocks
+ * count with the size of their class.
+ */
+#ifndef configHEAP_TASK_STAT
+#define configHEAP_TASK_STAT    configHEAP_TELEMETRY
+#endif
+
+#if configHEAP_TASK_STAT && !configHEAP_TELEMETRY
+#error configHEAP_TASK_STAT needs configHEAP_TELEMETRY
+#endif
+
+/*
+ * Integrity check, for debug builds. Each block gets a guard word after its
+ * data and goes on a list of live blocks; the idle hook checks
+ * configHEAP_CHECK_STEP of them at most once a tick, so a whole pass takes
+ * blocks / configHEAP_CHECK_STEP ticks. The guard is also checked on free.
+ * The first corrupt block is reported with the site that allocated it and
+ * checking stops there. Costs 12 bytes a block and needs the telemetry header.
+ * The slab classes are skipped while it is on, their blocks have no guard.
+ */
+#ifndef configHEAP_CHECK
+#define configHEAP_CHECK        0
+#endif
+
+#ifndef configHEAP_CHECK_STEP
+#define configHEAP_CHECK_STEP   16
+#endif
+
+#if configHEAP_CHECK && !configHEAP_TELEMETRY
+#error configHEAP_CHECK needs configHEAP_TELEMETRY
+#endif
+
+/* slot of the task local storage that holds the accounting entry */
+#define HEAP_TASK_TLS_INDEX     0
+/* stored in the slot when the table was full */
+#define HEAP_TASK_TLS_NONE      OS_HEAP_TASK_NUM
+
+#define HEAP_STAT_MAGIC         0xA55A
+
+typedef struct heap_stat_hdr
+{
+#if configHEAP_CHECK
+    struct heap_stat_hdr *next;
+    struct heap_stat_hdr *prev;
+#endif
+    uint32_t size;
+    uint8_t site;
+    uint8_t task;
+    uint16_t magic;
+} heap_stat_hdr_t;
+
+#if configHEAP_TELEMETRY
+#define HEAP_STAT_HDR_SIZE      sizeof(heap_stat_hdr_t)
+#else
+#define HEAP_STAT_HDR_SIZE      0
+#endif
+
+/* blocks are taken rounded up to this, the rest of the last word is usable */
+#define HEAP_ALIGN_SIZE(size)   (((size) + 7) & ~7)
+
+#define HEAP_GUARD_WORD         0xC0DEFACE
+
+#if configHEAP_CHECK
+#define HEAP_GUARD_SIZE         4
+#else
+#define HEAP_GUARD_SIZE         0
+#endif
+
+/* taken from the heap for size bytes of data, without the header */
+#define HEAP_BLOCK_SIZE(size)   HEAP_ALIGN_SIZE((size) + HEAP_GUARD_SIZE)
+/* the guard word follows the data right away, the rounding is not usable then */
+#define HEAP_USABLE_SIZE(size)  (HEAP_GUARD_SIZE ? (size) : HEAP_ALIGN_SIZE(size))
+
+static os_heap_stat_t s_heap_stat[OS_HEAP_NUM] = {0};
+static uint32_t s_heap_min_ever_free = 0;
+/* entry 0 collects the sites that did not fit in the table */
+static os_heap_site_t s_heap_sites[OS_HEAP_SITE_NUM] = {0};
+
+#if configHEAP_TASK_STAT
+/* entry 0 collects isrs, allocations before the scheduler runs and tasks that did not fit */
+static os_heap_task_t s_heap_tasks[OS_HEAP_TASK_NUM] = {{"other"}};
+#endif
+
+#if configHEAP_CHECK
+/* newest block first, abandoned once a fault is found */
+static heap_stat_hdr_t *s_heap_live = NULL;
+/* the next block the idle check looks at, NULL to start a pass */
+static heap_stat_hdr_t *s_heap_check_next = NULL;
+static TickType_t s_heap_check_tick = 0;
+static int s_heap_check_reported = 0;
+static os_heap_check_stat_t s_heap_check = {0};
+#endif
+
+static int s_heap_ready = 0;
+static HEAP_HANDLE s_heap_handle[OS_HEAP_NUM] = {NULL};
+
+#if configHEAP_TRACE
+static os_heap_trace_t s_heap_trace[configHEAP_TRACE_NUM];
+static uint32_t s_heap_trace_head = 0;
+static uint32_t s_heap_trace_tail = 0;
+static uint32_t s_heap_trace_lost = 0;
+static volatile int s_heap_trace_on = 0;
+/* tasks seen by the trace, record task n is entry n - 1 */
+static TaskHandle_t s_heap_trace_task[OS_HEAP_TRACE_TASK_NUM] = {NULL};
+static char s_heap_trace_name[OS_HEAP_TRACE_TASK_NUM][configMAX_TASK_NAME_LEN];
+#endif
 
 extern void bk_printf(const char *fmt, ...);
 
@@ -105,8 +277,9 @@ extern void bk_printf(const char *fmt, ...);
 extern unsigned char _empty_ram;
 extern unsigned char _tcmbss_end;
 
+/* the tcm region of the linker script ends where dtcm starts */
 #define TCMBSS_START_ADDRESS (void*)&_tcmbss_end
-#define TCMBSS_END_ADDRESS   (void*)(0x003F0000 + 60*1024 - 512)
+#define TCMBSS_END_ADDRESS   (void*)(0x003F0000 + 55 * 1024)
 
 #define HEAP_START_ADDRESS    (void*)&_empty_ram
 #if (CFG_SOC_NAME == SOC_BK7231N)
@@ -115,17 +288,47 @@ extern unsigned char _tcmbss_end;
 #define HEAP_END_ADDRESS      (void*)(0x00400000 + 256 * 1024)
 #endif
 
-static void *prvHeapGetHeaderPointer(void)
+static void *prvHeapGetHeaderPointer(int heap)
 {
+    if(OS_HEAP_FAST == heap) {
+        return (void *)TCMBSS_START_ADDRESS;
+    }
+
 	return (void *)HEAP_START_ADDRESS;
 }
 
-static uint32_t prvHeapGetTotalSize(void)
+static uint32_t prvHeapGetTotalSize(int heap)
 {
+    if(OS_HEAP_FAST == heap) {
+        if(TCMBSS_END_ADDRESS <= TCMBSS_START_ADDRESS) {
+            return 0;
+        }
+        return (TCMBSS_END_ADDRESS - TCMBSS_START_ADDRESS);
+    }
+
 	ASSERT(HEAP_END_ADDRESS > HEAP_START_ADDRESS);
 	return (HEAP_END_ADDRESS - HEAP_START_ADDRESS);
 }
 
+static int prvHeapOf(const void *pv)
+{
+    if((const uint8_t *)pv >= (const uint8_t *)TCMBSS_START_ADDRESS &&
+       (const uint8_t *)pv < (const uint8_t *)TCMBSS_END_ADDRESS) {
+        return OS_HEAP_FAST;
+    }
+
+    return OS_HEAP_MAIN;
+}
+
+static uint32_t prvHeapAvailable(int heap)
+{
+    if(NULL == s_heap_handle[heap]) {
+        return 0;
+    }
+
+    return heap_backend_available(s_heap_handle[heap]);
+}
+
 static void prvHeapInit( void )
 {
     int ret = 0;
@@ -133,65 +336,1302 @@ static void prvHeapInit( void )
     ctx.dbg_output = bk_printf;
     ctx.enter_critical = vTaskSuspendAll;
     ctx.exit_critical = xTaskResumeAll;
-    ret = tuya_mem_heap_init(&ctx);
+    ret = heap_backend_init(&ctx);
     if(0 != ret) {
         bk_printf("--------->heap init err:%d", ret);
         return;
     }
 
-    // ret = tuya_mem_heap_create(TCMBSS_START_ADDRESS, TCMBSS_END_ADDRESS-TCMBSS_START_ADDRESS, &s_heap_tss_handle);
-    // if(0 != ret) {
-    //     bk_printf("--------->heap create tss err:%d", ret);
-    // }
-
-    ret = tuya_mem_heap_create(prvHeapGetHeaderPointer(), prvHeapGetTotalSize(), &s_heap_handle);
+    ret = heap_backend_create(prvHeapGetHeaderPointer(OS_HEAP_MAIN), prvHeapGetTotalSize(OS_HEAP_MAIN), &s_heap_handle[OS_HEAP_MAIN]);
     if(0 != ret) {
         bk_printf("--------->heap create err:%d", ret);
     }
 
-    // bk_printf("tcm free heap %d\r\n", TCMBSS_END_ADDRESS - TCMBSS_START_ADDRESS);
-    // bk_printf("free heap %d\r\n",xPortGetFreeHeapSize());
+    /* without the tcm heap everything just goes to the main heap */
+    if(prvHeapGetTotalSize(OS_HEAP_FAST) > 0) {
+        ret = heap_backend_create(prvHeapGetHeaderPointer(OS_HEAP_FAST), prvHeapGetTotalSize(OS_HEAP_FAST), &s_heap_handle[OS_HEAP_FAST]);
+        if(0 != ret) {
+            bk_printf("--------->heap create tcm err:%d", ret);
+            s_heap_handle[OS_HEAP_FAST] = NULL;
+        }
+    }
+
+    s_heap_ready = 1;
 }
 
-void *pvPortMalloc( size_t xWantedSize )
+#if configHEAP_TELEMETRY
+static uint16_t prvHeapSiteIndex(const void *site, uint32_t line)
 {
-    if(NULL == s_heap_handle) {
-        prvHeapInit();
+    uint32_t hash = ((uint32_t)site >> 2) ^ line;
+    uint32_t idx, i;
+
+    for(i = 0; i < OS_HEAP_SITE_NUM - 1; i++) {
+        idx = 1 + (hash + i) % (OS_HEAP_SITE_NUM - 1);
+        if(s_heap_sites[idx].site == site && s_heap_sites[idx].line == line) {
+            return idx;
+        }
+        if(s_heap_sites[idx].site == NULL) {
+            s_heap_sites[idx].site = site;
+            s_heap_sites[idx].line = line;
+            return idx;
+        }
     }
 
-    if(xWantedSize == 0) {
-        xWantedSize = 4;
+    return 0;
+}
+#endif
+
+#if configHEAP_TASK_STAT
+/* called with the scheduler suspended, create also makes an entry for a task without one */
+static uint8_t prvHeapTaskEntry(TaskHandle_t task, int create)
+{
+    uint32_t idx;
+    int i;
+
+    if(NULL == task) {
+        return 0;
+    }
+
+    idx = (uint32_t)pvTaskGetThreadLocalStoragePointer(task, HEAP_TASK_TLS_INDEX);
+    if(idx) {
+        return (HEAP_TASK_TLS_NONE == idx) ? 0 : idx;
+    }
+    if(!create) {
+        return 0;
+    }
+
+    /* a deleted task's entry is taken over once its blocks are all freed */
+    for(i = 1; i < OS_HEAP_TASK_NUM; i++) {
+        if(NULL == s_heap_tasks[i].task && 0 == s_heap_tasks[i].blocks) {
+            memset(&s_heap_tasks[i], 0, sizeof(os_heap_task_t));
+            s_heap_tasks[i].task = task;
+            strncpy(s_heap_tasks[i].name, pcTaskGetName(task), OS_HEAP_TASK_NAME_LEN - 1);
+            vTaskSetThreadLocalStoragePointer(task, HEAP_TASK_TLS_INDEX, (void *)i);
+            return i;
+        }
     }
 
-	return tuya_mem_heap_malloc(0, xWantedSize);
+    vTaskSetThreadLocalStoragePointer(task, HEAP_TASK_TLS_INDEX, (void *)HEAP_TASK_TLS_NONE);
+    return 0;
 }
 
+static uint8_t prvHeapTaskCurrent(void)
+{
+    if(platform_is_in_interrupt_context() || taskSCHEDULER_NOT_STARTED == xTaskGetSchedulerState()) {
+        return 0;
+    }
 
-void vPortFree( void *pv )
+    return prvHeapTaskEntry(xTaskGetCurrentTaskHandle(), 1);
+}
+
+/* called with the scheduler suspended, false if growing task by size breaks its hard limit */
+static int prvHeapTaskAdmit(uint8_t task, size_t size)
+{
+    os_heap_task_t *entry = &s_heap_tasks[task];
+
+    if(entry->hard_limit && entry->bytes + size > entry->hard_limit) {
+        entry->fail_count ++;
+        return 0;
+    }
+    if(entry->soft_limit && entry->bytes + size > entry->soft_limit) {
+        entry->over_soft ++;
+    }
+
+    return 1;
+}
+#endif
+
+#if configHEAP_CHECK
+/* a header address inside one of the heaps, or NULL */
+static int prvHeapCheckAddr(const heap_stat_hdr_t *hdr)
 {
-    tuya_mem_heap_free(0, pv);
+    const uint8_t *pv = (const uint8_t *)hdr;
+
+    if(NULL == hdr) {
+        return 1;
+    }
+    if((uint32_t)pv & 3) {
+        return 0;
+    }
+
+    return (pv >= (const uint8_t *)HEAP_START_ADDRESS && pv < (const uint8_t *)HEAP_END_ADDRESS) ||
+           (pv >= (const uint8_t *)TCMBSS_START_ADDRESS && pv < (const uint8_t *)TCMBSS_END_ADDRESS);
 }
-/*-----------------------------------------------------------*/
 
-size_t xPortGetFreeHeapSize( void )
+/* the data size is not a multiple of 4, the guard is written bytewise */
+static void prvHeapGuardSet(heap_stat_hdr_t *hdr)
 {
-	return tuya_mem_heap_available(0);
+    uint32_t guard = HEAP_GUARD_WORD;
+
+    memcpy((uint8_t *)hdr + HEAP_STAT_HDR_SIZE + hdr->size, &guard, sizeof(guard));
 }
-/*-----------------------------------------------------------*/
 
-size_t xPortGetMinimumEverFreeHeapSize( void )
+static int prvHeapGuardIntact(const heap_stat_hdr_t *hdr)
 {
-	return 0;
+    uint32_t guard;
+
+    memcpy(&guard, (const uint8_t *)hdr + HEAP_STAT_HDR_SIZE + hdr->size, sizeof(guard));
+
+    return HEAP_GUARD_WORD == guard;
 }
-/*-----------------------------------------------------------*/
 
-void vPortInitialiseBlocks( void )
+/* what is wrong with a block on the live list, NULL when nothing is */
+static const char *prvHeapCheckBlock(const heap_stat_hdr_t *hdr)
 {
-	/* This just exists to keep the linker quiet. */
+    if(HEAP_STAT_MAGIC != hdr->magic || hdr->site >= OS_HEAP_SITE_NUM || hdr->task >= OS_HEAP_TASK_NUM) {
+        return "header";
+    }
+    if(!prvHeapGuardIntact(hdr)) {
+        return "overrun";
+    }
+    if(!prvHeapCheckAddr(hdr->next) || (hdr->next && hdr->next->prev != hdr)) {
+        return "link";
+    }
+
+    return NULL;
 }
 
-void *pvPortRealloc( void *pv, size_t xWantedSize )
+/*
+ * Keeps the first fault. The list may be broken from here on, so it is
+ * dropped and blocks are no longer linked or checked. Called with the
+ * scheduler suspended.
+ */
+static void prvHeapCheckFault(const heap_stat_hdr_t *hdr, const char *what)
+{
+    if(s_heap_check.bad_block) {
+        return;
+    }
+
+    s_heap_check.bad_block = (uint8_t *)hdr + HEAP_STAT_HDR_SIZE;
+    s_heap_check.what = what;
+    /* a broken header has no site worth trusting */
+    if(HEAP_STAT_MAGIC == hdr->magic && hdr->site < OS_HEAP_SITE_NUM) {
+        s_heap_check.bad_size = hdr->size;
+        s_heap_check.site = s_heap_sites[hdr->site].site;
+        s_heap_check.line = s_heap_sites[hdr->site].line;
+    }
+
+    s_heap_live = NULL;
+    s_heap_check_next = NULL;
+}
+
+/* prints the fault once, with the scheduler running */
+static void prvHeapCheckReport(void)
+{
+    if(NULL == s_heap_check.bad_block || s_heap_check_reported) {
+        return;
+    }
+    s_heap_check_reported = 1;
+
+    if(s_heap_check.line) {
+        bk_printf("heap: %s at block %p size %d from %s:%d\r\n", s_heap_check.what, s_heap_check.bad_block,
+                  s_heap_check.bad_size, (const char *)s_heap_check.site, s_heap_check.line);
+    } else if(s_heap_check.site) {
+        bk_printf("heap: %s at block %p size %d from 0x%08x\r\n", s_heap_check.what, s_heap_check.bad_block,
+                  s_heap_check.bad_size, (uint32_t)s_heap_check.site);
+    } else {
+        bk_printf("heap: %s at block %p\r\n", s_heap_check.what, s_heap_check.bad_block);
+    }
+}
+
+static void prvHeapCheckLink(heap_stat_hdr_t *hdr)
+{
+    prvHeapGuardSet(hdr);
+
+    if(s_heap_check.bad_block) {
+        return;
+    }
+
+    hdr->prev = NULL;
+    hdr->next = s_heap_live;
+    if(s_heap_live) {
+        s_heap_live->prev = hdr;
+    }
+    s_heap_live = hdr;
+}
+
+static void prvHeapCheckUnlink(heap_stat_hdr_t *hdr)
+{
+    if(!prvHeapGuardIntact(hdr)) {
+        prvHeapCheckFault(hdr, "overrun");
+    }
+
+    if(s_heap_check.bad_block) {
+        return;
+    }
+
+    if(!prvHeapCheckAddr(hdr->prev) || !prvHeapCheckAddr(hdr->next) ||
+       (hdr->prev && hdr->prev->next != hdr) || (hdr->next && hdr->next->prev != hdr) ||
+       (NULL == hdr->prev && s_heap_live != hdr)) {
+        prvHeapCheckFault(hdr, "link");
+        return;
+    }
+
+    if(s_heap_check_next == hdr) {
+        s_heap_check_next = hdr->next;
+    }
+    if(hdr->prev) {
+        hdr->prev->next = hdr->next;
+    } else {
+        s_heap_live = hdr->next;
+    }
+    if(hdr->next) {
+        hdr->next->prev = hdr->prev;
+    }
+}
+
+/* checks up to num blocks from where the last call stopped, ends at the end of a pass */
+static void prvHeapCheckStep(uint32_t num)
+{
+    heap_stat_hdr_t *hdr;
+    const char *what;
+
+    if(NULL == s_heap_check_next) {
+        s_heap_check_next = s_heap_live;
+    }
+
+    while(num-- && s_heap_check_next) {
+        hdr = s_heap_check_next;
+        what = prvHeapCheckBlock(hdr);
+        if(what) {
+            prvHeapCheckFault(hdr, what);
+            return;
+        }
+        s_heap_check.blocks ++;
+
+        s_heap_check_next = hdr->next;
+        if(NULL == s_heap_check_next) {
+            s_heap_check.passes ++;
+        }
+    }
+}
+#endif
+
+/* called with the scheduler suspended */
+static void prvHeapStatAlloc(int heap, void *pv, size_t size, const void *site, uint32_t line, uint8_t task)
+{
+    os_heap_stat_t *stat = &s_heap_stat[heap];
+    uint32_t free_size;
+#if configHEAP_TELEMETRY
+    heap_stat_hdr_t *hdr = (heap_stat_hdr_t *)pv;
+    os_heap_site_t *entry;
+#endif
+
+    stat->alloc_count ++;
+    stat->blocks ++;
+
+    free_size = prvHeapAvailable(heap);
+    if(free_size < stat->min_ever_free || 0 == stat->min_ever_free) {
+        stat->min_ever_free = free_size;
+    }
+    free_size = prvHeapAvailable(OS_HEAP_MAIN) + prvHeapAvailable(OS_HEAP_FAST);
+    if(free_size < s_heap_min_ever_free || 0 == s_heap_min_ever_free) {
+        s_heap_min_ever_free = free_size;
+    }
+
+#if configHEAP_TELEMETRY
+    hdr->size = size;
+    hdr->site = prvHeapSiteIndex(site, line);
+    hdr->task = task;
+    hdr->magic = HEAP_STAT_MAGIC;
+#if configHEAP_CHECK
+    prvHeapCheckLink(hdr);
+#endif
+
+    stat->used_size += size;
+    if(stat->used_size > stat->peak_used) {
+        stat->peak_used = stat->used_size;
+    }
+
+    entry = &s_heap_sites[hdr->site];
+    entry->bytes += size;
+    entry->blocks ++;
+    if(entry->bytes > entry->peak_bytes) {
+        entry->peak_bytes = entry->bytes;
+    }
+#endif
+
+#if configHEAP_TASK_STAT
+    s_heap_tasks[task].bytes += size;
+    s_heap_tasks[task].blocks ++;
+    if(s_heap_tasks[task].bytes > s_heap_tasks[task].peak_bytes) {
+        s_heap_tasks[task].peak_bytes = s_heap_tasks[task].bytes;
+    }
+#endif
+}
+
+/* called with the scheduler suspended, false if pv is not a live block */
+static int prvHeapStatFree(int heap, void *pv)
+{
+    os_heap_stat_t *stat = &s_heap_stat[heap];
+#if configHEAP_TELEMETRY
+    heap_stat_hdr_t *hdr = (heap_stat_hdr_t *)pv;
+    os_heap_site_t *entry;
+
+    if(HEAP_STAT_MAGIC != hdr->magic || hdr->site >= OS_HEAP_SITE_NUM || hdr->task >= OS_HEAP_TASK_NUM) {
+        stat->bad_free ++;
+        return 0;
+    }
+#if configHEAP_CHECK
+    prvHeapCheckUnlink(hdr);
+#endif
+    hdr->magic = 0;
+
+    stat->used_size -= hdr->size;
+
+    entry = &s_heap_sites[hdr->site];
+    entry->bytes -= hdr->size;
+    entry->blocks --;
+#endif
+
+#if configHEAP_TASK_STAT
+    s_heap_tasks[hdr->task].bytes -= hdr->size;
+    s_heap_tasks[hdr->task].blocks --;
+#endif
+
+    stat->free_count ++;
+    stat->blocks --;
+
+    return 1;
+}
+
+/*
+ * Slab blocks have no header, the site and the task ride in the tag the slab
+ * keeps per block. They count with the size of their class, for the sites and
+ * tasks only: the heap statistics already hold the slab arena as one block.
+ */
+#define HEAP_SLAB_TAG(site, task)   ((uint16_t)((site) | ((task) << 8)))
+#define HEAP_SLAB_TAG_SITE(tag)     ((tag) & 0xFF)
+#define HEAP_SLAB_TAG_TASK(tag)     ((tag) >> 8)
+
+/* called with the scheduler suspended */
+static void prvHeapStatSlab(uint16_t tag, size_t size, int alloc)
+{
+#if configHEAP_TELEMETRY
+    os_heap_site_t *entry = &s_heap_sites[HEAP_SLAB_TAG_SITE(tag)];
+
+    if(alloc) {
+        entry->bytes += size;
+        entry->blocks ++;
+        if(entry->bytes > entry->peak_bytes) {
+            entry->peak_bytes = entry->bytes;
+        }
+    } else {
+        entry->bytes -= size;
+        entry->blocks --;
+    }
+#endif
+
+#if configHEAP_TASK_STAT
+    os_heap_task_t *task = &s_heap_tasks[HEAP_SLAB_TAG_TASK(tag)];
+
+    if(alloc) {
+        task->bytes += size;
+        task->blocks ++;
+        if(task->bytes > task->peak_bytes) {
+            task->peak_bytes = task->bytes;
+        }
+    } else {
+        task->bytes -= size;
+        task->blocks --;
+    }
+#endif
+}
+
+/* false if pv is not a slab or pool block */
+static int prvHeapSlabFree(void *pv)
+{
+    uint32_t size = os_slab_block_size(pv);
+    uint16_t tag = OS_SLAB_NO_TAG;
+
+    if(0 == size) {
+        return 0;
+    }
+
+    /* a double free is refused and reported by the slab */
+    if(os_slab_free(pv, &tag) > 0 && OS_SLAB_NO_TAG != tag) {
+        vTaskSuspendAll();
+        prvHeapStatSlab(tag, size, 0);
+        ( void ) xTaskResumeAll();
+    }
+
+    return 1;
+}
+
+#if configHEAP_TRACE
+/* interrupts disabled */
+static uint8_t prvHeapTraceTask(void)
+{
+    TaskHandle_t task;
+    int i;
+
+    if(platform_is_in_interrupt_context() || taskSCHEDULER_NOT_STARTED == xTaskGetSchedulerState()) {
+        return 0;
+    }
+
+    task = xTaskGetCurrentTaskHandle();
+    for(i = 0; i < OS_HEAP_TRACE_TASK_NUM; i++) {
+        if(s_heap_trace_task[i] == task) {
+            return i + 1;
+        }
+        if(NULL == s_heap_trace_task[i]) {
+            s_heap_trace_task[i] = task;
+            strncpy(s_heap_trace_name[i], pcTaskGetName(task), configMAX_TASK_NAME_LEN - 1);
+            return i + 1;
+        }
+    }
+
+    return OS_HEAP_TRACE_TASK_OTHER;
+}
+
+static void prvHeapTrace(uint8_t op, const void *pv, const void *old, size_t size)
 {
-	return tuya_mem_heap_realloc(0, pv, xWantedSize);
+    os_heap_trace_t *rec;
+    uint32_t next;
+    uint64_t stamp;
+    GLOBAL_INT_DECLARATION();
+
+    if(!s_heap_trace_on) {
+        return;
+    }
+
+    stamp = fclk_get_us();
+
+    GLOBAL_INT_DISABLE();
+    next = (s_heap_trace_head + 1) % configHEAP_TRACE_NUM;
+    if(next == s_heap_trace_tail) {
+        s_heap_trace_lost ++;
+        GLOBAL_INT_RESTORE();
+        return;
+    }
+    rec = &s_heap_trace[s_heap_trace_head];
+    rec->stamp = (uint32_t)stamp;
+    rec->ptr = (uint32_t)pv;
+    rec->old = (uint32_t)old;
+    rec->size = size;
+    rec->op = op;
+    rec->task = prvHeapTraceTask();
+    rec->heap = (NULL == pv) ? 0 : prvHeapOf(pv);
+    rec->reserved = 0;
+    s_heap_trace_head = next;
+    GLOBAL_INT_RESTORE();
 }
+#else
+#define prvHeapTrace(op, pv, old, size)
+#endif
+
+/* called with the scheduler suspended, returns the block header or NULL, or a slab block without one */
+static void *prvHeapAlloc(size_t size, uint32_t flags, const void *site, uint32_t line, int *slab)
+{
+    int heap = flags & OS_HEAP_ID_MASK;
+    int other;
+    void *pv = NULL;
+    uint8_t task = 0;
+    uint16_t site_idx = 0;
 
+    if(heap >= OS_HEAP_NUM) {
+        heap = OS_HEAP_MAIN;
+    }
+    other = (OS_HEAP_MAIN == heap) ? OS_HEAP_FAST : OS_HEAP_MAIN;
+
+#if configHEAP_TASK_STAT
+    task = prvHeapTaskCurrent();
+    if(!prvHeapTaskAdmit(task, size)) {
+        return NULL;
+    }
+#endif
+
+    /* small main heap blocks come from the slab, it has no room for the guard words */
+    if(!configHEAP_CHECK && OS_HEAP_MAIN == heap && !(flags & OS_HEAP_NO_SLAB)) {
+#if configHEAP_TELEMETRY
+        site_idx = prvHeapSiteIndex(site, line);
+#endif
+        pv = os_slab_alloc(size, HEAP_SLAB_TAG(site_idx, task));
+        if(pv) {
+            prvHeapStatSlab(HEAP_SLAB_TAG(site_idx, task), os_slab_block_size(pv), 1);
+            *slab = 1;
+            return pv;
+        }
+    }
+
+    if(s_heap_handle[heap]) {
+        pv = heap_backend_malloc(s_heap_handle[heap], HEAP_BLOCK_SIZE(size) + HEAP_STAT_HDR_SIZE);
+    }
+
+    if(NULL == pv && s_heap_handle[other] && !(flags & OS_HEAP_NO_SPILL) &&
+       (OS_HEAP_FAST == heap || configHEAP_MAIN_SPILL)) {
+        pv = heap_backend_malloc(s_heap_handle[other], HEAP_BLOCK_SIZE(size) + HEAP_STAT_HDR_SIZE);
+        if(pv) {
+            s_heap_stat[other].spill_count ++;
+            heap = other;
+        }
+    }
+
+    if(NULL == pv) {
+        s_heap_stat[heap].fail_count ++;
+        return NULL;
+    }
+
+    prvHeapStatAlloc(heap, pv, size, site, line, task);
+
+    return pv;
+}
+
+static void *prvPortMallocHeap( size_t xWantedSize, uint32_t ulFlags, const void *pvSite, int xLine )
+{
+    void *pv;
+    int slab = 0;
+
+    if(!s_heap_ready) {
+        prvHeapInit();
+    }
+
+    if(xWantedSize == 0) {
+        xWantedSize = 4;
+    }
+
+    vTaskSuspendAll();
+    pv = prvHeapAlloc(xWantedSize, ulFlags, pvSite, xLine, &slab);
+    ( void ) xTaskResumeAll();
+
+    if(NULL == pv || slab) {
+        return pv;
+    }
+
+    return (uint8_t *)pv + HEAP_STAT_HDR_SIZE;
+}
+
+void *pvPortMallocHeap( size_t xWantedSize, uint32_t ulFlags, const void *pvSite, int xLine )
+{
+    void *pv = prvPortMallocHeap(xWantedSize, ulFlags, pvSite, xLine);
+
+    prvHeapTrace(OS_HEAP_TRACE_ALLOC, pv, NULL, xWantedSize);
+
+    return pv;
+}
+
+void *pvPortMallocTrace( size_t xWantedSize, const void *pvSite, int xLine )
+{
+    return pvPortMallocHeap(xWantedSize, OS_HEAP_MAIN, pvSite, xLine);
+}
+
+static void prvPortFree( void *pv )
+{
+    int heap, live;
+
+    if(NULL == pv) {
+        return;
+    }
+
+    if(prvHeapSlabFree(pv)) {
+        return;
+    }
+
+    pv = (uint8_t *)pv - HEAP_STAT_HDR_SIZE;
+    heap = prvHeapOf(pv);
+
+    vTaskSuspendAll();
+    live = prvHeapStatFree(heap, pv);
+    ( void ) xTaskResumeAll();
+
+#if configHEAP_CHECK
+    prvHeapCheckReport();
+#endif
+
+    /* a double free or a foreign pointer would corrupt the heap, leave it */
+    if(!live) {
+        bk_printf("heap: bad free %p\r\n", (uint8_t *)pv + HEAP_STAT_HDR_SIZE);
+        return;
+    }
+
+    heap_backend_free(s_heap_handle[heap], pv);
+}
+
+#if OSMALLOC_STATISTICAL
+void *pvPortMalloc_cm(const char *call_func_name, int line, size_t xWantedSize, int need_zero )
+{
+    void *pv = pvPortMallocTrace(xWantedSize, call_func_name, line);
+
+    if(pv && need_zero) {
+        os_memset(pv, 0, xWantedSize);
+    }
+
+    return pv;
+}
+
+void *vPortFree_cm(const char *call_func_name, int line, void *pv )
+{
+    prvHeapTrace(OS_HEAP_TRACE_FREE, pv, NULL, 0);
+    prvPortFree(pv);
+
+    return NULL;
+}
+#else
+void *pvPortMalloc( size_t xWantedSize )
+{
+    return pvPortMallocTrace(xWantedSize, __builtin_return_address(0), 0);
+}
+
+void vPortFree( void *pv )
+{
+    prvHeapTrace(OS_HEAP_TRACE_FREE, pv, NULL, 0);
+    prvPortFree(pv);
+}
+#endif
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return prvHeapAvailable(OS_HEAP_MAIN) + prvHeapAvailable(OS_HEAP_FAST);
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return s_heap_min_ever_free;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+
+/* pvSite is the caller of pvPortRealloc(), kept when a new block is taken */
+static void *prvPortRealloc( void *pv, size_t xWantedSize, const void *pvSite )
+{
+    void *pvNew;
+    const void *site;
+    uint32_t line;
+    size_t old_size = 0;
+    uint8_t task = 0;
+    int heap;
+#if configHEAP_TELEMETRY
+    heap_stat_hdr_t *hdr;
+#endif
+
+    if(NULL == pv) {
+        return prvPortMallocHeap(xWantedSize, OS_HEAP_MAIN, pvSite, 0);
+    }
+
+    if(0 == xWantedSize) {
+        prvPortFree(pv);
+        return NULL;
+    }
+
+    /* a slab block is reused while the new size fits its class */
+    old_size = os_slab_block_size(pv);
+    if(old_size) {
+        if(xWantedSize <= old_size) {
+            return pv;
+        }
+        pvNew = prvPortMallocHeap(xWantedSize, OS_HEAP_MAIN, pvSite, 0);
+        if(pvNew) {
+            memcpy(pvNew, pv, old_size);
+            prvHeapSlabFree(pv);
+        }
+        return pvNew;
+    }
+
+    pv = (uint8_t *)pv - HEAP_STAT_HDR_SIZE;
+    heap = prvHeapOf(pv);
+
+    /* the block keeps the call site and the task that allocated it */
+    site = pvSite;
+    line = 0;
+    vTaskSuspendAll();
+#if configHEAP_TELEMETRY
+    hdr = (heap_stat_hdr_t *)pv;
+    if(HEAP_STAT_MAGIC == hdr->magic && hdr->site < OS_HEAP_SITE_NUM && hdr->task < OS_HEAP_TASK_NUM) {
+        site = s_heap_sites[hdr->site].site;
+        line = s_heap_sites[hdr->site].line;
+        task = hdr->task;
+        old_size = hdr->size;
+#if configHEAP_TASK_STAT
+        if(xWantedSize > old_size && !prvHeapTaskAdmit(task, xWantedSize - old_size)) {
+            ( void ) xTaskResumeAll();
+            return NULL;
+        }
+#endif
+    }
+#endif
+    if(!prvHeapStatFree(heap, pv)) {
+        ( void ) xTaskResumeAll();
+        bk_printf("heap: bad realloc %p\r\n", (uint8_t *)pv + HEAP_STAT_HDR_SIZE);
+        return NULL;
+    }
+    /* within the rounding of the block the heap has nothing to do */
+    if(old_size && HEAP_BLOCK_SIZE(xWantedSize) == HEAP_BLOCK_SIZE(old_size)) {
+        pvNew = pv;
+    } else {
+        /* the heap resizes in place when the neighbouring block allows it */
+        pvNew = heap_backend_realloc(s_heap_handle[heap], pv, HEAP_BLOCK_SIZE(xWantedSize) + HEAP_STAT_HDR_SIZE);
+    }
+    /* on failure the old block is still there */
+    if(NULL == pvNew) {
+        prvHeapStatAlloc(heap, pv, old_size, site, line, task);
+        if(0 == old_size) {
+            s_heap_stat[heap].fail_count ++;
+        }
+    } else {
+        prvHeapStatAlloc(heap, pvNew, xWantedSize, site, line, task);
+    }
+    s_heap_stat[heap].alloc_count --;
+    s_heap_stat[heap].free_count --;
+    ( void ) xTaskResumeAll();
+
+#if configHEAP_CHECK
+    prvHeapCheckReport();
+#endif
+
+    if(pvNew) {
+        return (uint8_t *)pvNew + HEAP_STAT_HDR_SIZE;
+    }
+
+    /*
+     * The heap could not fit the new size in its own area, try the other one.
+     * Only the usable part of the old block is copied, so this needs the size
+     * from the telemetry header.
+     */
+    if(0 == old_size) {
+        return NULL;
+    }
+    pvNew = prvPortMallocHeap(xWantedSize, heap | OS_HEAP_NO_SLAB, site, line);
+    if(NULL == pvNew) {
+        return NULL;
+    }
+    pv = (uint8_t *)pv + HEAP_STAT_HDR_SIZE;
+    memcpy(pvNew, pv, (xWantedSize < HEAP_USABLE_SIZE(old_size)) ? xWantedSize : HEAP_USABLE_SIZE(old_size));
+    prvPortFree(pv);
+
+    return pvNew;
+}
+
+void *pvPortRealloc( void *pv, size_t xWantedSize )
+{
+    void *pvNew = prvPortRealloc(pv, xWantedSize, __builtin_return_address(0));
+
+    prvHeapTrace(OS_HEAP_TRACE_REALLOC, pvNew, pv, xWantedSize);
+
+    return pvNew;
+}
+
+size_t xPortGetUsableSize( void *pv )
+{
+    size_t size;
+#if configHEAP_TELEMETRY
+    heap_stat_hdr_t *hdr;
+#endif
+
+    if(NULL == pv) {
+        return 0;
+    }
+
+    size = os_slab_block_size(pv);
+    if(size) {
+        return size;
+    }
+
+#if configHEAP_TELEMETRY
+    hdr = (heap_stat_hdr_t *)((uint8_t *)pv - HEAP_STAT_HDR_SIZE);
+    if(HEAP_STAT_MAGIC == hdr->magic) {
+        return HEAP_USABLE_SIZE(hdr->size);
+    }
+#endif
+
+    /* without the header the size is not known */
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+void *os_malloc_heap(size_t size, UINT32 flags)
+{
+    return pvPortMallocHeap(size, flags, __builtin_return_address(0), 0);
+}
+
+void *os_malloc_fast(size_t size)
+{
+    return pvPortMallocHeap(size, OS_HEAP_FAST, __builtin_return_address(0), 0);
+}
+
+void *os_zalloc_fast(size_t size)
+{
+    void *pv = pvPortMallocHeap(size, OS_HEAP_FAST, __builtin_return_address(0), 0);
+
+    if(pv) {
+        os_memset(pv, 0, size);
+    }
+
+    return pv;
+}
+
+int os_heap_of(const void *ptr)
+{
+    return prvHeapOf(ptr);
+}
+
+size_t os_malloc_usable_size(void *ptr)
+{
+    return xPortGetUsableSize(ptr);
+}
+
+void os_heap_get_stat(int heap, os_heap_stat_t *stat)
+{
+    if(NULL == stat || heap < 0 || heap >= OS_HEAP_NUM) {
+        return;
+    }
+
+    vTaskSuspendAll();
+    *stat = s_heap_stat[heap];
+    ( void ) xTaskResumeAll();
+
+    stat->total_size = (NULL == s_heap_handle[heap]) ? 0 : prvHeapGetTotalSize(heap);
+    stat->free_size = prvHeapAvailable(heap);
+}
+
+int os_heap_get_sites(os_heap_site_t *sites, int max)
+{
+    int i, num = 0;
+
+    if(NULL == sites) {
+        return 0;
+    }
+
+    vTaskSuspendAll();
+    for(i = 0; i < OS_HEAP_SITE_NUM && num < max; i++) {
+        if(s_heap_sites[i].blocks || s_heap_sites[i].peak_bytes) {
+            sites[num ++] = s_heap_sites[i];
+        }
+    }
+    ( void ) xTaskResumeAll();
+
+    return num;
+}
+
+/* called by vTaskDelete() through traceTASK_DELETE, the entry stays until its blocks are freed */
+void vPortHeapTaskDelete( void *pvTask )
+{
+#if configHEAP_TASK_STAT
+    uint8_t task = prvHeapTaskEntry((TaskHandle_t)pvTask, 0);
+
+    if(task) {
+        s_heap_tasks[task].task = NULL;
+    }
+#endif
+}
+
+int os_heap_task_set_limit(void *task, UINT32 soft_limit, UINT32 hard_limit)
+{
+#if configHEAP_TASK_STAT
+    uint8_t idx;
+
+    if(NULL == task) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+
+    vTaskSuspendAll();
+    idx = prvHeapTaskEntry((TaskHandle_t)task, 1);
+    if(idx) {
+        s_heap_tasks[idx].soft_limit = soft_limit;
+        s_heap_tasks[idx].hard_limit = hard_limit;
+    }
+    ( void ) xTaskResumeAll();
+
+    return idx ? 0 : -1;
+#else
+    return -1;
+#endif
+}
+
+UINT32 os_heap_task_bytes(void *task)
+{
+#if configHEAP_TASK_STAT
+    uint8_t idx;
+
+    if(NULL == task) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+
+    idx = prvHeapTaskEntry((TaskHandle_t)task, 0);
+    return idx ? s_heap_tasks[idx].bytes : 0;
+#else
+    return 0;
+#endif
+}
+
+int os_heap_get_tasks(os_heap_task_t *tasks, int max)
+{
+    int num = 0;
+#if configHEAP_TASK_STAT
+    int i;
+
+    if(NULL == tasks) {
+        return 0;
+    }
+
+    vTaskSuspendAll();
+    for(i = 0; i < OS_HEAP_TASK_NUM && num < max; i++) {
+        if(0 == i || s_heap_tasks[i].task || s_heap_tasks[i].blocks) {
+            tasks[num ++] = s_heap_tasks[i];
+        }
+    }
+    ( void ) xTaskResumeAll();
+#endif
+
+    return num;
+}
+
+/* from the idle hook, checks a few blocks once a tick */
+void vPortHeapCheckIdle( void )
+{
+#if configHEAP_CHECK
+    TickType_t tick = xTaskGetTickCount();
+    UINT64 start;
+    uint32_t took;
+
+    if(tick == s_heap_check_tick || s_heap_check.bad_block) {
+        return;
+    }
+    s_heap_check_tick = tick;
+
+    start = fclk_get_us();
+    vTaskSuspendAll();
+    prvHeapCheckStep(configHEAP_CHECK_STEP);
+    ( void ) xTaskResumeAll();
+    took = (uint32_t)(fclk_get_us() - start);
+
+    s_heap_check.steps ++;
+    s_heap_check.total_us += took;
+    if(took > s_heap_check.max_us) {
+        s_heap_check.max_us = took;
+    }
+
+    prvHeapCheckReport();
+#endif
+}
+
+int os_heap_check(void)
+{
+#if configHEAP_CHECK
+    vTaskSuspendAll();
+    s_heap_check_next = NULL;
+    prvHeapCheckStep(0xFFFFFFFF);
+    ( void ) xTaskResumeAll();
+
+    prvHeapCheckReport();
+
+    return NULL == s_heap_check.bad_block;
+#else
+    return 1;
+#endif
+}
+
+void os_heap_check_get_stat(os_heap_check_stat_t *stat)
+{
+    if(NULL == stat) {
+        return;
+    }
+
+#if configHEAP_CHECK
+    vTaskSuspendAll();
+    *stat = s_heap_check;
+    ( void ) xTaskResumeAll();
+#else
+    memset(stat, 0, sizeof(*stat));
+#endif
+}
+
+void os_heap_reset_peak(void)
+{
+    int i;
+
+    vTaskSuspendAll();
+    for(i = 0; i < OS_HEAP_NUM; i++) {
+        s_heap_stat[i].peak_used = s_heap_stat[i].used_size;
+        s_heap_stat[i].min_ever_free = prvHeapAvailable(i);
+    }
+    s_heap_min_ever_free = prvHeapAvailable(OS_HEAP_MAIN) + prvHeapAvailable(OS_HEAP_FAST);
+    for(i = 0; i < OS_HEAP_SITE_NUM; i++) {
+        s_heap_sites[i].peak_bytes = s_heap_sites[i].bytes;
+    }
+#if configHEAP_TASK_STAT
+    for(i = 0; i < OS_HEAP_TASK_NUM; i++) {
+        s_heap_tasks[i].peak_bytes = s_heap_tasks[i].bytes;
+    }
+#endif
+    ( void ) xTaskResumeAll();
+}
+
+static uint32_t prvHeapHistClass(uint32_t size)
+{
+    uint32_t cls = 0;
+
+    size >>= 5;
+    while(size && cls < OS_HEAP_HIST_NUM - 1) {
+        size >>= 1;
+        cls ++;
+    }
+
+    return cls;
+}
+
+/*
+ * The heap does not expose its free list, so the free blocks are measured by
+ * taking them: the largest block that can be allocated is found by bisection,
+ * kept, and the next one is searched until nothing is left or the probe limit
+ * is hit. The kept blocks are chained through their first word and given back
+ * at the end. Everything runs with the scheduler suspended.
+ */
+void os_heap_get_frag(int heap, os_heap_frag_t *frag)
+{
+    HEAP_HANDLE handle;
+    void *chain = NULL;
+    void *pv;
+    uint32_t lo, hi, mid, free_size;
+
+    if(NULL == frag) {
+        return;
+    }
+
+    memset(frag, 0, sizeof(os_heap_frag_t));
+
+    if(heap < 0 || heap >= OS_HEAP_NUM || NULL == s_heap_handle[heap]) {
+        return;
+    }
+    handle = s_heap_handle[heap];
+
+    vTaskSuspendAll();
+    free_size = heap_backend_available(handle);
+
+    while(frag->free_blocks < OS_HEAP_PROBE_MAX) {
+        lo = sizeof(void *);
+        hi = heap_backend_available(handle);
+
+        pv = heap_backend_malloc(handle, lo);
+        if(NULL == pv) {
+            break;
+        }
+        heap_backend_free(handle, pv);
+
+        while(lo < hi) {
+            mid = lo + (hi - lo + 1) / 2;
+            pv = heap_backend_malloc(handle, mid);
+            if(pv) {
+                heap_backend_free(handle, pv);
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+
+        pv = heap_backend_malloc(handle, lo);
+        if(NULL == pv) {
+            break;
+        }
+        *(void **)pv = chain;
+        chain = pv;
+
+        if(lo > frag->largest_free) {
+            frag->largest_free = lo;
+        }
+        frag->hist[prvHeapHistClass(lo)] ++;
+        frag->free_blocks ++;
+    }
+
+    while(chain) {
+        pv = chain;
+        chain = *(void **)pv;
+        heap_backend_free(handle, pv);
+    }
+    ( void ) xTaskResumeAll();
+
+    if(free_size > 0 && frag->largest_free < free_size) {
+        frag->fragmentation = 100 - (uint32_t)((uint64_t)frag->largest_free * 100 / free_size);
+    }
+}
+
+void os_heap_dump(void)
+{
+    static const char *names[OS_HEAP_NUM] = {"main", "tcm"};
+    os_heap_stat_t stat;
+    os_heap_frag_t frag;
+    os_heap_site_t sites[OS_HEAP_SITE_NUM];
+    os_heap_task_t tasks[OS_HEAP_TASK_NUM];
+    int heap, i, num;
+
+    for(heap = 0; heap < OS_HEAP_NUM; heap++) {
+        os_heap_get_stat(heap, &stat);
+        if(0 == stat.total_size) {
+            continue;
+        }
+        os_heap_get_frag(heap, &frag);
+
+        bk_printf("%s heap: total %d free %d min free %d\r\n", names[heap],
+                  stat.total_size, stat.free_size, stat.min_ever_free);
+        bk_printf("%s heap: used %d peak %d blocks %d allocs %d frees %d fails %d spills %d bad frees %d\r\n",
+                  names[heap], stat.used_size, stat.peak_used, stat.blocks, stat.alloc_count,
+                  stat.free_count, stat.fail_count, stat.spill_count, stat.bad_free);
+        bk_printf("%s heap: largest free %d, %d free blocks, fragmentation %d%%\r\n",
+                  names[heap], frag.largest_free, frag.free_blocks, frag.fragmentation);
+        bk_printf("%s heap: free blocks", names[heap]);
+        for(i = 0; i < OS_HEAP_HIST_NUM; i++) {
+            if(i == OS_HEAP_HIST_NUM - 1) {
+                bk_printf(" >=%d:%d", 32 << (i - 1), frag.hist[i]);
+            } else {
+                bk_printf(" <%d:%d", 32 << i, frag.hist[i]);
+            }
+        }
+        bk_printf("\r\n");
+    }
+
+    num = os_heap_get_sites(sites, OS_HEAP_SITE_NUM);
+    for(i = 0; i < num; i++) {
+        if(NULL == sites[i].site) {
+            bk_printf("heap site %-24s bytes %d blocks %d peak %d\r\n", "other",
+                      sites[i].bytes, sites[i].blocks, sites[i].peak_bytes);
+        } else if(sites[i].line) {
+            bk_printf("heap site %s:%d bytes %d blocks %d peak %d\r\n", (const char *)sites[i].site,
+                      sites[i].line, sites[i].bytes, sites[i].blocks, sites[i].peak_bytes);
+        } else {
+            bk_printf("heap site 0x%08x bytes %d blocks %d peak %d\r\n", (uint32_t)sites[i].site,
+                      sites[i].bytes, sites[i].blocks, sites[i].peak_bytes);
+        }
+    }
+
+    num = os_heap_get_tasks(tasks, OS_HEAP_TASK_NUM);
+    for(i = 0; i < num; i++) {
+        bk_printf("heap task %-16s%s bytes %d blocks %d peak %d limits %d/%d over soft %d refused %d\r\n",
+                  tasks[i].name, (i && NULL == tasks[i].task) ? "(gone)" : "", tasks[i].bytes,
+                  tasks[i].blocks, tasks[i].peak_bytes, tasks[i].soft_limit, tasks[i].hard_limit,
+                  tasks[i].over_soft, tasks[i].fail_count);
+    }
+
+#if configHEAP_CHECK
+    {
+        os_heap_check_stat_t check;
+        UINT64 uptime = fclk_get_us();
+
+        os_heap_check_get_stat(&check);
+        bk_printf("heap check: passes %d blocks %d steps %d time %dus max %dus, %d per mille of cpu\r\n",
+                  check.passes, check.blocks, check.steps, check.total_us, check.max_us,
+                  uptime ? (uint32_t)((UINT64)check.total_us * 1000 / uptime) : 0);
+        if(check.bad_block) {
+            bk_printf("heap check: %s at block %p\r\n", check.what, check.bad_block);
+        }
+    }
+#endif
+
+    os_slab_dump();
+}
+
+#if configHEAP_TRACE
+void os_heap_trace_start(void)
+{
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    s_heap_trace_head = 0;
+    s_heap_trace_tail = 0;
+    s_heap_trace_lost = 0;
+    s_heap_trace_on = 1;
+    GLOBAL_INT_RESTORE();
+}
+
+void os_heap_trace_stop(void)
+{
+    s_heap_trace_on = 0;
+}
+
+int os_heap_trace_read(os_heap_trace_t *recs, int max)
+{
+    int num = 0;
+    GLOBAL_INT_DECLARATION();
+
+    if(NULL == recs) {
+        return 0;
+    }
+
+    GLOBAL_INT_DISABLE();
+    while(num < max && s_heap_trace_tail != s_heap_trace_head) {
+        recs[num ++] = s_heap_trace[s_heap_trace_tail];
+        s_heap_trace_tail = (s_heap_trace_tail + 1) % configHEAP_TRACE_NUM;
+    }
+    GLOBAL_INT_RESTORE();
+
+    return num;
+}
+
+UINT32 os_heap_trace_lost(void)
+{
+    return s_heap_trace_lost;
+}
+
+const char *os_heap_trace_task(int task)
+{
+    if(task < 1 || task > OS_HEAP_TRACE_TASK_NUM || NULL == s_heap_trace_task[task - 1]) {
+        return NULL;
+    }
+
+    return s_heap_trace_name[task - 1];
+}
+
+void os_heap_trace_pool(UINT8 op, const void *ptr, UINT32 size)
+{
+    prvHeapTrace(op, ptr, NULL, size);
+}
+#else
+void os_heap_trace_start(void)
+{
+    bk_printf("heap trace: not built in, set configHEAP_TRACE\r\n");
+}
+
+void os_heap_trace_stop(void)
+{
+}
+
+int os_heap_trace_read(os_heap_trace_t *recs, int max)
+{
+    return 0;
+}
+
+UINT32 os_heap_trace_lost(void)
+{
+    return 0;
+}
+
+const char *os_heap_trace_task(int task)
+{
+    return NULL;
+}
+
+void os_heap_trace_pool(UINT8 op, const void *ptr, UINT32 size)
+{
+}
+#endif
+
+/*
+ * One line per record: "ht <stamp> <op> <task> <heap> <ptr> <old> <size>",
+ * all hex, op is a(lloc), f(ree) or r(ealloc). The task names follow as
+ * "ht task <n> <name>" lines.
+ */
+void os_heap_trace_dump(void)
+{
+    static const char ops[] = {'?', 'a', 'f', 'r'};
+    os_heap_trace_t rec;
+    const char *name;
+    int i;
+
+    while(os_heap_trace_read(&rec, 1)) {
+        bk_printf("ht %08x %c %02x %x %08x %08x %x\r\n", rec.stamp,
+                  ops[(rec.op < sizeof(ops)) ? rec.op : 0], rec.task, rec.heap,
+                  rec.ptr, rec.old, rec.size);
+    }
+
+    for(i = 1; i <= OS_HEAP_TRACE_TASK_NUM; i++) {
+        name = os_heap_trace_task(i);
+        if(name) {
+            bk_printf("ht task %02x %s\r\n", i, name);
+        }
+    }
+    bk_printf("ht lost %d\r\n", os_heap_trace_lost());
+}
@@ -0,0 +1,428 @@
+/*
+ * Two level segregated fit allocator, after M. Masmano et al., "TLSF: a new
+ * dynamic memory allocator for real-time systems".
+ *
+ * Free blocks are kept in lists indexed by the position of the top bit of
+ * their size (first level) and the next TLSF_SL_LOG2 bits (second level).
+ * Two bitmaps tell which lists are non-empty, so finding a fitting block is
+ * a pair of count-leading-zero instructions rather than a list walk.
+ *
+ * Every block starts with a header holding the physically previous
+ * block and the payload size; the low bits of the size carry the free flags.
+ * A free block also holds its list links in the payload. A zero sized used
+ * block at the end of each pool stops coalescing.
+ */
+#include "include.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "heap_tlsf.h"
+
+#define TLSF_ALIGN_LOG2         3
+#define TLSF_ALIGN              (1 << TLSF_ALIGN_LOG2)
+#define TLSF_SL_LOG2            4
+#define TLSF_SL_COUNT           (1 << TLSF_SL_LOG2)
+/* blocks up to 1 MB */
+#define TLSF_FL_MAX             20
+#define TLSF_FL_SHIFT           (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_FL_COUNT           (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+#define TLSF_SMALL_BLOCK        (1 << TLSF_FL_SHIFT)
+
+#define TLSF_BLOCK_FREE         0x1
+#define TLSF_BLOCK_PREV_FREE    0x2
+#define TLSF_BLOCK_FLAGS        (TLSF_BLOCK_FREE | TLSF_BLOCK_PREV_FREE)
+
+typedef struct tlsf_block
+{
+    struct tlsf_block *prev_phys;
+    uint32_t size;
+    /* only in free blocks */
+    struct tlsf_block *next_free;
+    struct tlsf_block *prev_free;
+} tlsf_block_t;
+
+#define TLSF_BLOCK_HDR          offsetof(tlsf_block_t, next_free)
+#define TLSF_BLOCK_MIN          (sizeof(tlsf_block_t) - TLSF_BLOCK_HDR)
+#define TLSF_BLOCK_MAX          ((1 << TLSF_FL_MAX) - TLSF_BLOCK_HDR)
+
+typedef struct
+{
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[TLSF_FL_COUNT];
+    tlsf_block_t *blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    uint32_t free_size;
+} tlsf_control_t;
+
+static heap_context_t s_tlsf_ctx = {NULL, NULL, NULL};
+
+static void prvTlsfLock(void)
+{
+    if(s_tlsf_ctx.enter_critical) {
+        s_tlsf_ctx.enter_critical();
+    }
+}
+
+static void prvTlsfUnlock(void)
+{
+    if(s_tlsf_ctx.exit_critical) {
+        s_tlsf_ctx.exit_critical();
+    }
+}
+
+static inline int prvTlsfFls(uint32_t word)
+{
+    return 31 - __builtin_clz(word);
+}
+
+static inline int prvTlsfFfs(uint32_t word)
+{
+    return __builtin_ctz(word);
+}
+
+static inline uint32_t prvBlockSize(const tlsf_block_t *block)
+{
+    return block->size & ~TLSF_BLOCK_FLAGS;
+}
+
+static inline void prvBlockSetSize(tlsf_block_t *block, uint32_t size)
+{
+    block->size = size | (block->size & TLSF_BLOCK_FLAGS);
+}
+
+static inline int prvBlockIsFree(const tlsf_block_t *block)
+{
+    return block->size & TLSF_BLOCK_FREE;
+}
+
+static inline void *prvBlockToPtr(tlsf_block_t *block)
+{
+    return (uint8_t *)block + TLSF_BLOCK_HDR;
+}
+
+static inline tlsf_block_t *prvBlockFromPtr(void *ptr)
+{
+    return (tlsf_block_t *)((uint8_t *)ptr - TLSF_BLOCK_HDR);
+}
+
+static inline tlsf_block_t *prvBlockNext(tlsf_block_t *block)
+{
+    return (tlsf_block_t *)((uint8_t *)prvBlockToPtr(block) + prvBlockSize(block));
+}
+
+/* the free flag of a block is mirrored in the next block */
+static void prvBlockMarkFree(tlsf_block_t *block, int free)
+{
+    tlsf_block_t *next = prvBlockNext(block);
+
+    if(free) {
+        block->size |= TLSF_BLOCK_FREE;
+        next->size |= TLSF_BLOCK_PREV_FREE;
+        next->prev_phys = block;
+    } else {
+        block->size &= ~TLSF_BLOCK_FREE;
+        next->size &= ~TLSF_BLOCK_PREV_FREE;
+    }
+}
+
+static void prvMappingInsert(uint32_t size, int *fl, int *sl)
+{
+    if(size < TLSF_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT);
+    } else {
+        *fl = prvTlsfFls(size);
+        *sl = (size >> (*fl - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+        *fl -= TLSF_FL_SHIFT - 1;
+    }
+}
+
+/* rounds up to the next list so that any block found there fits */
+static void prvMappingSearch(uint32_t size, int *fl, int *sl)
+{
+    if(size >= TLSF_SMALL_BLOCK) {
+        size += (1 << (prvTlsfFls(size) - TLSF_SL_LOG2)) - 1;
+    }
+    prvMappingInsert(size, fl, sl);
+}
+
+static tlsf_block_t *prvSearchSuitable(tlsf_control_t *ctrl, int *fl, int *sl)
+{
+    uint32_t sl_map, fl_map;
+
+    if(*fl >= TLSF_FL_COUNT) {
+        return NULL;
+    }
+
+    sl_map = ctrl->sl_bitmap[*fl] & (~0U << *sl);
+    if(0 == sl_map) {
+        fl_map = (*fl + 1 < 32) ? ctrl->fl_bitmap & (~0U << (*fl + 1)) : 0;
+        if(0 == fl_map) {
+            return NULL;
+        }
+        *fl = prvTlsfFfs(fl_map);
+        sl_map = ctrl->sl_bitmap[*fl];
+    }
+    *sl = prvTlsfFfs(sl_map);
+
+    return ctrl->blocks[*fl][*sl];
+}
+
+static void prvRemoveFree(tlsf_control_t *ctrl, tlsf_block_t *block)
+{
+    int fl, sl;
+
+    prvMappingInsert(prvBlockSize(block), &fl, &sl);
+
+    if(block->next_free) {
+        block->next_free->prev_free = block->prev_free;
+    }
+    if(block->prev_free) {
+        block->prev_free->next_free = block->next_free;
+    }
+    if(ctrl->blocks[fl][sl] == block) {
+        ctrl->blocks[fl][sl] = block->next_free;
+        if(NULL == block->next_free) {
+            ctrl->sl_bitmap[fl] &= ~(1U << sl);
+            if(0 == ctrl->sl_bitmap[fl]) {
+                ctrl->fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+    ctrl->free_size -= prvBlockSize(block);
+}
+
+static void prvInsertFree(tlsf_control_t *ctrl, tlsf_block_t *block)
+{
+    int fl, sl;
+
+    prvMappingInsert(prvBlockSize(block), &fl, &sl);
+
+    block->prev_free = NULL;
+    block->next_free = ctrl->blocks[fl][sl];
+    if(block->next_free) {
+        block->next_free->prev_free = block;
+    }
+    ctrl->blocks[fl][sl] = block;
+    ctrl->fl_bitmap |= 1U << fl;
+    ctrl->sl_bitmap[fl] |= 1U << sl;
+    ctrl->free_size += prvBlockSize(block);
+}
+
+/* merges a free block that is in no list with its free neighbours */
+static tlsf_block_t *prvMerge(tlsf_control_t *ctrl, tlsf_block_t *block)
+{
+    tlsf_block_t *next = prvBlockNext(block);
+    tlsf_block_t *prev;
+
+    if(prvBlockIsFree(next)) {
+        prvRemoveFree(ctrl, next);
+        prvBlockSetSize(block, prvBlockSize(block) + TLSF_BLOCK_HDR + prvBlockSize(next));
+    }
+
+    if(block->size & TLSF_BLOCK_PREV_FREE) {
+        prev = block->prev_phys;
+        prvRemoveFree(ctrl, prev);
+        prvBlockSetSize(prev, prvBlockSize(prev) + TLSF_BLOCK_HDR + prvBlockSize(block));
+        block = prev;
+    }
+
+    prvBlockMarkFree(block, 1);
+
+    return block;
+}
+
+/* gives the tail of a used block beyond size back to the free lists */
+static void prvTrim(tlsf_control_t *ctrl, tlsf_block_t *block, uint32_t size)
+{
+    tlsf_block_t *rest;
+    uint32_t rest_size;
+
+    if(prvBlockSize(block) < size + TLSF_BLOCK_HDR + TLSF_BLOCK_MIN) {
+        return;
+    }
+
+    rest_size = prvBlockSize(block) - size - TLSF_BLOCK_HDR;
+    prvBlockSetSize(block, size);
+
+    rest = prvBlockNext(block);
+    rest->prev_phys = block;
+    rest->size = rest_size;
+    prvInsertFree(ctrl, prvMerge(ctrl, rest));
+}
+
+static uint32_t prvAdjustSize(unsigned int size)
+{
+    if(size < TLSF_BLOCK_MIN) {
+        size = TLSF_BLOCK_MIN;
+    }
+    if(size > TLSF_BLOCK_MAX) {
+        return 0;
+    }
+
+    return (size + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1);
+}
+
+static void *prvMalloc(tlsf_control_t *ctrl, unsigned int size)
+{
+    tlsf_block_t *block;
+    uint32_t adjust = prvAdjustSize(size);
+    int fl, sl;
+
+    if(0 == adjust) {
+        return NULL;
+    }
+
+    prvMappingSearch(adjust, &fl, &sl);
+    block = prvSearchSuitable(ctrl, &fl, &sl);
+    if(NULL == block) {
+        return NULL;
+    }
+
+    prvRemoveFree(ctrl, block);
+    prvBlockMarkFree(block, 0);
+    prvTrim(ctrl, block, adjust);
+
+    return prvBlockToPtr(block);
+}
+
+static void prvFree(tlsf_control_t *ctrl, void *ptr)
+{
+    tlsf_block_t *block = prvBlockFromPtr(ptr);
+
+    prvInsertFree(ctrl, prvMerge(ctrl, block));
+}
+
+int tlsf_heap_init(heap_context_t *ctx)
+{
+    if(NULL == ctx) {
+        return -1;
+    }
+
+    s_tlsf_ctx = *ctx;
+
+    return 0;
+}
+
+int tlsf_heap_create(void *start_addr, unsigned int size, HEAP_HANDLE *handle)
+{
+    tlsf_control_t *ctrl;
+    tlsf_block_t *block, *sentinel;
+    uint8_t *start = (uint8_t *)(((uintptr_t)start_addr + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1));
+    uint8_t *end = (uint8_t *)(((uintptr_t)start_addr + size) & ~(TLSF_ALIGN - 1));
+    uint8_t *pool;
+
+    if(NULL == handle) {
+        return -1;
+    }
+
+    pool = start + ((sizeof(tlsf_control_t) + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1));
+    /* room for the control block, one block header and the sentinel */
+    if(end <= pool || (uint32_t)(end - pool) < 2 * TLSF_BLOCK_HDR + TLSF_BLOCK_MIN ||
+       (uint32_t)(end - pool) - 2 * TLSF_BLOCK_HDR > TLSF_BLOCK_MAX) {
+        return -2;
+    }
+
+    ctrl = (tlsf_control_t *)start;
+    memset(ctrl, 0, sizeof(tlsf_control_t));
+
+    block = (tlsf_block_t *)pool;
+    block->prev_phys = NULL;
+    block->size = (end - pool) - 2 * TLSF_BLOCK_HDR;
+
+    sentinel = prvBlockNext(block);
+    sentinel->prev_phys = block;
+    sentinel->size = 0;
+
+    prvBlockMarkFree(block, 1);
+    prvInsertFree(ctrl, block);
+
+    *handle = ctrl;
+
+    return 0;
+}
+
+void *tlsf_heap_malloc(HEAP_HANDLE handle, unsigned int size)
+{
+    void *ptr;
+
+    if(NULL == handle) {
+        return NULL;
+    }
+
+    prvTlsfLock();
+    ptr = prvMalloc((tlsf_control_t *)handle, size);
+    prvTlsfUnlock();
+
+    return ptr;
+}
+
+void tlsf_heap_free(HEAP_HANDLE handle, void *ptr)
+{
+    if(NULL == handle || NULL == ptr) {
+        return;
+    }
+
+    prvTlsfLock();
+    prvFree((tlsf_control_t *)handle, ptr);
+    prvTlsfUnlock();
+}
+
+/* grows into a free next block or shrinks in place, moves only when it must */
+void *tlsf_heap_realloc(HEAP_HANDLE handle, void *ptr, unsigned int size)
+{
+    tlsf_control_t *ctrl = (tlsf_control_t *)handle;
+    tlsf_block_t *block, *next;
+    uint32_t adjust, cur;
+    void *new_ptr = NULL;
+
+    if(NULL == ptr) {
+        return tlsf_heap_malloc(handle, size);
+    }
+    if(0 == size) {
+        tlsf_heap_free(handle, ptr);
+        return NULL;
+    }
+
+    adjust = prvAdjustSize(size);
+    if(NULL == ctrl || 0 == adjust) {
+        return NULL;
+    }
+
+    prvTlsfLock();
+    block = prvBlockFromPtr(ptr);
+    cur = prvBlockSize(block);
+    next = prvBlockNext(block);
+
+    if(adjust > cur && prvBlockIsFree(next) && cur + TLSF_BLOCK_HDR + prvBlockSize(next) >= adjust) {
+        prvRemoveFree(ctrl, next);
+        prvBlockSetSize(block, cur + TLSF_BLOCK_HDR + prvBlockSize(next));
+        prvBlockMarkFree(block, 0);
+        cur = prvBlockSize(block);
+    }
+
+    if(adjust <= cur) {
+        prvTrim(ctrl, block, adjust);
+        new_ptr = ptr;
+    } else {
+        new_ptr = prvMalloc(ctrl, size);
+        if(new_ptr) {
+            memcpy(new_ptr, ptr, cur);
+            prvFree(ctrl, ptr);
+        }
+    }
+    prvTlsfUnlock();
+
+    return new_ptr;
+}
+
+int tlsf_heap_available(HEAP_HANDLE handle)
+{
+    if(NULL == handle) {
+        return 0;
+    }
+
+    return ((tlsf_control_t *)handle)->free_size;
+}
+
+// EOF
@@ -6,10 +6,12 @@
 #include "sys_rtos.h"
 #include "timers.h"
 #include "rtos_pub.h"
+#include "timer_wheel.h"
 #include "generic.h"
 
 #include "includes.h"
 #include "uart_pub.h"
+#include "mem_pub.h"
 #include "string.h"
 
 /******************************************************
@@ -26,6 +28,10 @@
 #endif
 #define TIMER_QUEUE_LENGTH  5
 
+/* cpu load sampling, one slot per period, the long window is all slots */
+#define CPU_LOAD_PERIOD_MS  1000
+#define CPU_LOAD_HIST       10
+
 /*
  * Macros used by vListTask to indicate which state a task is in.
  */
@@ -61,6 +67,16 @@ typedef struct
     void*           arg;
 } beken_event_message_t;
 
+typedef struct
+{
+    TaskHandle_t  task;
+    UBaseType_t   number;                   /* handles are reused, task numbers are not */
+    uint32_t      last;                     /* run time counter at the last sample */
+    uint16_t      hist[CPU_LOAD_HIST];      /* per mille of each period */
+    uint8_t       seen;
+    char          name[RTOS_CPU_NAME_LEN];
+} cpu_load_task_t;
+
 
 /******************************************************
  *               Function Declarations
@@ -83,6 +99,16 @@ uint32_t  ms_to_tick_ratio = 2;
 
 uint32_t rtos_max_priorities = RTOS_HIGHEST_PRIORITY - RTOS_LOWEST_PRIORITY + 1;
 
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+static beken_timer_t cpu_load_timer = {0};
+static cpu_load_task_t cpu_load_tasks[RTOS_CPU_TASK_NUM];
+static uint16_t cpu_load_hist[CPU_LOAD_HIST];
+static uint32_t cpu_load_last = 0;
+static uint8_t cpu_load_primed = 0;
+static uint32_t cpu_load_samples = 0;
+static uint32_t cpu_load_read_ns = 0;
+#endif
+
 /******************************************************
  *               Function Definitions
  ******************************************************/
@@ -148,6 +174,237 @@ beken_thread_t* rtos_get_current_thread( void )
     return (beken_thread_t *)xTaskGetCurrentTaskHandle();
 }
 
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+static uint16_t cpu_load_per_mille( uint32_t run, uint32_t period )
+{
+    uint64_t load;
+
+    if ( period == 0 )
+    {
+        return 0;
+    }
+
+    load = (uint64_t)run * 1000 / period;
+
+    return ( load > 1000 ) ? 1000 : (uint16_t)load;
+}
+
+static uint16_t cpu_load_average( const uint16_t *hist )
+{
+    uint32_t i, num, sum = 0;
+
+    num = ( cpu_load_samples < CPU_LOAD_HIST ) ? cpu_load_samples : CPU_LOAD_HIST;
+    if ( num == 0 )
+    {
+        return 0;
+    }
+
+    for ( i = 0; i < num; i++ )
+    {
+        sum += hist[i];
+    }
+
+    return sum / num;
+}
+
+static uint16_t cpu_load_latest( const uint16_t *hist )
+{
+    if ( cpu_load_samples == 0 )
+    {
+        return 0;
+    }
+
+    return hist[( cpu_load_samples - 1 ) % CPU_LOAD_HIST];
+}
+
+static cpu_load_task_t *cpu_load_find( UBaseType_t number, int create )
+{
+    cpu_load_task_t *entry = NULL;
+    int i;
+
+    for ( i = 0; i < RTOS_CPU_TASK_NUM; i++ )
+    {
+        if ( cpu_load_tasks[i].task != NULL && cpu_load_tasks[i].number == number )
+        {
+            return &cpu_load_tasks[i];
+        }
+        if ( entry == NULL && cpu_load_tasks[i].task == NULL )
+        {
+            entry = &cpu_load_tasks[i];
+        }
+    }
+
+    return create ? entry : NULL;
+}
+
+/* runs in the timer task once a period */
+static void cpu_load_sample( void *arg )
+{
+    TaskStatus_t *status;
+    cpu_load_task_t *entry;
+    UBaseType_t num, x;
+    uint32_t now, period, slot;
+    uint16_t idle = 0;
+    int i;
+
+    num = uxTaskGetNumberOfTasks();
+    status = pvPortMalloc( num * sizeof(TaskStatus_t) );
+    if ( status == NULL )
+    {
+        return;
+    }
+
+    num = uxTaskGetSystemState( status, num, &now );
+    period = now - cpu_load_last;
+    slot = cpu_load_samples % CPU_LOAD_HIST;
+
+    vTaskSuspendAll();
+    for ( i = 0; i < RTOS_CPU_TASK_NUM; i++ )
+    {
+        cpu_load_tasks[i].seen = 0;
+    }
+
+    for ( x = 0; x < num; x++ )
+    {
+        entry = cpu_load_find( status[x].xTaskNumber, 1 );
+        if ( entry == NULL )
+        {
+            continue;
+        }
+
+        if ( entry->task == NULL )
+        {
+            /* new task, its load counts from here */
+            memset( entry, 0, sizeof(cpu_load_task_t) );
+            entry->task = status[x].xHandle;
+            entry->number = status[x].xTaskNumber;
+            strncpy( entry->name, status[x].pcTaskName, RTOS_CPU_NAME_LEN - 1 );
+        }
+        else
+        {
+            entry->hist[slot] = cpu_load_per_mille( status[x].ulRunTimeCounter - entry->last, period );
+        }
+        entry->last = status[x].ulRunTimeCounter;
+        entry->seen = 1;
+
+        if ( status[x].uxCurrentPriority == tskIDLE_PRIORITY && strcmp( status[x].pcTaskName, "IDLE" ) == 0 )
+        {
+            idle = entry->hist[slot];
+        }
+    }
+
+    for ( i = 0; i < RTOS_CPU_TASK_NUM; i++ )
+    {
+        if ( !cpu_load_tasks[i].seen )
+        {
+            cpu_load_tasks[i].task = NULL;
+        }
+    }
+
+    /* the first sample only sets the starting points */
+    if ( cpu_load_primed )
+    {
+        cpu_load_hist[slot] = 1000 - idle;
+        cpu_load_samples ++;
+    }
+    cpu_load_primed = 1;
+    cpu_load_last = now;
+    ( void ) xTaskResumeAll();
+
+    vPortFree( status );
+}
+#endif
+
+OSStatus rtos_cpu_load_start( void )
+{
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+    uint32_t start, took;
+    int i;
+    GLOBAL_INT_DECLARATION();
+
+    if ( cpu_load_timer.handle != NULL )
+    {
+        return kNoErr;
+    }
+
+    /* every context switch reads the counter once, that read is the overhead */
+    GLOBAL_INT_DISABLE();
+    start = portGET_RUN_TIME_COUNTER_VALUE();
+    for ( i = 0; i < 16; i++ )
+    {
+        ( void ) portGET_RUN_TIME_COUNTER_VALUE();
+    }
+    took = portGET_RUN_TIME_COUNTER_VALUE() - start;
+    GLOBAL_INT_RESTORE();
+    cpu_load_read_ns = (uint32_t)( (uint64_t)took * 1000000000 / configRUN_TIME_COUNTER_HZ / 17 );
+
+    if ( rtos_init_timer( &cpu_load_timer, CPU_LOAD_PERIOD_MS, cpu_load_sample, NULL ) != kNoErr )
+    {
+        cpu_load_timer.handle = NULL;
+        return kGeneralErr;
+    }
+
+    cpu_load_sample( NULL );
+
+    return rtos_start_timer( &cpu_load_timer );
+#else
+    return kUnsupportedErr;
+#endif
+}
+
+OSStatus rtos_get_cpu_load( rtos_cpu_load_t *load )
+{
+    if ( load == NULL )
+    {
+        return kParamErr;
+    }
+
+    memset( load, 0, sizeof(rtos_cpu_load_t) );
+
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+    vTaskSuspendAll();
+    load->load_1s = cpu_load_latest( cpu_load_hist );
+    load->load_10s = cpu_load_average( cpu_load_hist );
+    load->samples = cpu_load_samples;
+    load->read_ns = cpu_load_read_ns;
+    ( void ) xTaskResumeAll();
+
+    return kNoErr;
+#else
+    return kUnsupportedErr;
+#endif
+}
+
+int rtos_get_cpu_tasks( rtos_cpu_task_t *tasks, int max )
+{
+    int num = 0;
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+    int i;
+
+    if ( tasks == NULL )
+    {
+        return 0;
+    }
+
+    vTaskSuspendAll();
+    for ( i = 0; i < RTOS_CPU_TASK_NUM && num < max; i++ )
+    {
+        if ( cpu_load_tasks[i].task == NULL )
+        {
+            continue;
+        }
+        memcpy( tasks[num].name, cpu_load_tasks[i].name, RTOS_CPU_NAME_LEN );
+        tasks[num].task = cpu_load_tasks[i].task;
+        tasks[num].load_1s = cpu_load_latest( cpu_load_tasks[i].hist );
+        tasks[num].load_10s = cpu_load_average( cpu_load_tasks[i].hist );
+        num ++;
+    }
+    ( void ) xTaskResumeAll();
+#endif
+
+    return num;
+}
+
 #if FreeRTOS_VERSION_MAJOR == 7
 /* Old deployment, may has some problem */
 OSStatus rtos_print_thread_status( char* pcWriteBuffer, int xWriteBufferLen )
@@ -194,8 +451,12 @@ OSStatus rtos_print_thread_status( char* pcWriteBuffer, int xWriteBufferLen )
     unsigned portBASE_TYPE uxCurrentNumberOfTasks = uxTaskGetNumberOfTasks();
     volatile UBaseType_t uxArraySize, x;
     char cStatus;
-    char pcTaskStatusStr[48];
+    char pcTaskStatusStr[64];
     char *pcTaskStatusStrTmp;
+    unsigned int uxCpuLoad;
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+    cpu_load_task_t *pxCpuLoad;
+#endif
 
     /* Make sure the write buffer does not contain a string. */
     *pcWriteBuffer = 0x00;
@@ -209,8 +470,8 @@ OSStatus rtos_print_thread_status( char* pcWriteBuffer, int xWriteBufferLen )
      equate to NULL. */
     pxTaskStatusArray = pvPortMalloc( uxCurrentNumberOfTasks * sizeof(TaskStatus_t) );
 
-    cmd_printf("%-12s Status     Prio    Stack   TCB\r\n", "Name");
-    cmd_printf("-------------------------------------------\r\n");
+    cmd_printf("%-12s Status     Prio    Stack   TCB     Heap    CPU\r\n", "Name");
+    cmd_printf("-----------------------------------------------------------\r\n");
 
     xWriteBufferLen-=strlen(pcWriteBuffer);
 
@@ -252,11 +513,25 @@ OSStatus rtos_print_thread_status( char* pcWriteBuffer, int xWriteBufferLen )
             pcTaskStatusStrTmp = prvWriteNameToBuffer( pcTaskStatusStrTmp, pxTaskStatusArray[x].pcTaskName );
             //pcWriteBuffer = prvWriteNameToBuffer( pcWriteBuffer, pxTaskStatusArray[x].pcTaskName );
 
+            /* load over the last second, 0 until rtos_cpu_load_start() */
+            uxCpuLoad = 0;
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+            vTaskSuspendAll();
+            pxCpuLoad = cpu_load_find( pxTaskStatusArray[x].xTaskNumber, 0 );
+            if ( pxCpuLoad != NULL )
+            {
+                uxCpuLoad = cpu_load_latest( pxCpuLoad->hist );
+            }
+            ( void ) xTaskResumeAll();
+#endif
+
             /* Write the rest of the string. */
-            sprintf( pcTaskStatusStrTmp, "\t%c\t%u\t%u\t%u\r\n", cStatus,
+            sprintf( pcTaskStatusStrTmp, "\t%c\t%u\t%u\t%u\t%u\t%u.%u%%\r\n", cStatus,
                      BK_PRIORITY_TO_NATIVE_PRIORITY((unsigned int) pxTaskStatusArray[x].uxCurrentPriority),
                      (unsigned int) pxTaskStatusArray[x].usStackHighWaterMark,
-                     (unsigned int) pxTaskStatusArray[x].xTaskNumber );
+                     (unsigned int) pxTaskStatusArray[x].xTaskNumber,
+                     (unsigned int) os_heap_task_bytes( pxTaskStatusArray[x].xHandle ),
+                     uxCpuLoad / 10, uxCpuLoad % 10 );
 
             if( xWriteBufferLen < strlen( pcTaskStatusStr ) )
             {
@@ -666,6 +941,182 @@ BOOL rtos_is_queue_full( beken_queue_t* queue )
     return ( result != 0 ) ? true : false;
 }
 
+#if configUSE_TIMER_WHEEL
+/* the handle of a beken timer is a timer_wheel_timer_t, see timer_wheel.h */
+static void timer_callback2( void *larg, void *rarg )
+{
+    beken2_timer_t *timer = (beken2_timer_t*) larg;
+
+    if ( BEKEN_MAGIC_WORD != timer->beken_magic )
+    {
+        return;
+    }
+    if ( timer->function )
+    {
+        timer->function( timer->left_arg, timer->right_arg );
+    }
+}
+
+static void timer_callback1( void *larg, void *rarg )
+{
+    beken_timer_t *timer = (beken_timer_t*) larg;
+
+    if ( timer->function )
+    {
+        timer->function( timer->arg );
+    }
+}
+
+static OSStatus timer_wheel_create( void **handle, uint32_t time_ms, int periodic,
+                                    timer_wheel_handler_t function, void *larg )
+{
+    timer_wheel_timer_t *wheel_timer = (timer_wheel_timer_t *) os_malloc( sizeof( timer_wheel_timer_t ) );
+
+    *handle = wheel_timer;
+    if ( wheel_timer == NULL )
+    {
+        return kGeneralErr;
+    }
+
+    timer_wheel_init_timer( wheel_timer, time_ms, periodic, function, larg, NULL );
+
+    return kNoErr;
+}
+
+static void timer_wheel_delete( void **handle )
+{
+    timer_wheel_deinit_timer( (timer_wheel_timer_t *) *handle );
+    os_free( *handle );
+    *handle = NULL;
+}
+
+OSStatus rtos_init_oneshot_timer( beken2_timer_t *timer,
+                                  uint32_t time_ms,
+                                  timer_2handler_t function,
+                                  void* larg,
+                                  void* rarg )
+{
+    timer->function = function;
+    timer->left_arg = larg;
+    timer->right_arg = rarg;
+    timer->beken_magic = BEKEN_MAGIC_WORD;
+
+    return timer_wheel_create( &timer->handle, time_ms, 0, timer_callback2, timer );
+}
+
+OSStatus rtos_deinit_oneshot_timer( beken2_timer_t* timer )
+{
+    timer_wheel_delete( &timer->handle );
+    timer->function = 0;
+    timer->left_arg = 0;
+    timer->right_arg = 0;
+    timer->beken_magic = 0;
+
+    return kNoErr;
+}
+
+OSStatus rtos_start_oneshot_timer( beken2_timer_t* timer )
+{
+    return timer_wheel_start( (timer_wheel_timer_t *) timer->handle );
+}
+
+OSStatus rtos_stop_oneshot_timer( beken2_timer_t* timer )
+{
+    return timer_wheel_stop( (timer_wheel_timer_t *) timer->handle );
+}
+
+OSStatus rtos_oneshot_reload_timer( beken2_timer_t* timer )
+{
+    return timer_wheel_start( (timer_wheel_timer_t *) timer->handle );
+}
+
+BOOL rtos_is_oneshot_timer_init( beken2_timer_t* timer )
+{
+    return timer->handle ? true : false;
+}
+
+BOOL rtos_is_oneshot_timer_running( beken2_timer_t* timer )
+{
+    return timer_wheel_is_active( (timer_wheel_timer_t *) timer->handle ) ? true : false;
+}
+
+OSStatus rtos_init_timer( beken_timer_t *timer,
+                          uint32_t time_ms,
+                          timer_handler_t function,
+                          void* arg )
+{
+    timer->function = function;
+    timer->arg      = arg;
+
+    return timer_wheel_create( &timer->handle, time_ms, 1, timer_callback1, timer );
+}
+
+OSStatus rtos_start_timer( beken_timer_t* timer )
+{
+    return timer_wheel_start( (timer_wheel_timer_t *) timer->handle );
+}
+
+OSStatus rtos_stop_timer( beken_timer_t* timer )
+{
+    return timer_wheel_stop( (timer_wheel_timer_t *) timer->handle );
+}
+
+OSStatus rtos_reload_timer( beken_timer_t* timer )
+{
+    return timer_wheel_start( (timer_wheel_timer_t *) timer->handle );
+}
+
+OSStatus rtos_change_period( beken_timer_t* timer, uint32_t time_ms )
+{
+    return timer_wheel_change_period( (timer_wheel_timer_t *) timer->handle, time_ms );
+}
+
+OSStatus rtos_deinit_timer( beken_timer_t* timer )
+{
+    timer_wheel_delete( &timer->handle );
+
+    return kNoErr;
+}
+
+uint32_t rtos_get_timer_expiry_time( beken_timer_t* timer )
+{
+    return timer_wheel_get_expiry( (timer_wheel_timer_t *) timer->handle );
+}
+
+uint32_t rtos_get_next_expire_time()
+{
+    uint32_t tick = xTimerGetNextExpireTime();
+    uint32_t wheel_tick = timer_wheel_next_expiry();
+
+    /* the timer service task still runs the timers of xTimerCreate() users, 0 when it has none */
+    if ( wheel_tick != portMAX_DELAY && ( tick == 0 || ( int32_t )( wheel_tick - tick ) < 0 ) )
+    {
+        tick = wheel_tick;
+    }
+
+    return tick;
+}
+
+uint32_t rtos_get_current_timer_count(void)
+{
+    timer_wheel_stat_t stat;
+
+    timer_wheel_get_stat( &stat );
+
+    return xTimerGetCurrentTimerCount() + stat.active;
+}
+
+BOOL rtos_is_timer_init( beken_timer_t* timer )
+{
+    return timer->handle ? true : false;
+}
+
+BOOL rtos_is_timer_running( beken_timer_t* timer )
+{
+    return timer_wheel_is_active( (timer_wheel_timer_t *) timer->handle ) ? true : false;
+}
+
+#else
 static void timer_callback2( xTimerHandle handle )
 {
     beken2_timer_t *timer = (beken2_timer_t*) pvTimerGetTimerID( handle );
@@ -969,6 +1420,7 @@ BOOL rtos_is_timer_running( beken_timer_t* timer )
 {
     return ( xTimerIsTimerActive( timer->handle ) != 0 ) ? true : false;
 }
+#endif // configUSE_TIMER_WHEEL
 
 OSStatus rtos_init_event_flags( beken_event_flags_t* event_flags )
 {
@@ -87,6 +87,11 @@
 #define configTIMER_QUEUE_LENGTH                    ( 32 )
 #define configTIMER_TASK_STACK_DEPTH                ( ( unsigned short ) (3000 / sizeof( portSTACK_TYPE )) )
 
+/* beken_timer_t/beken2_timer_t on the timer wheel instead of the timer task, see timer_wheel.h */
+#define configUSE_TIMER_WHEEL                       0
+#define configTIMER_WHEEL_TASK_PRIORITY             configTIMER_TASK_PRIORITY
+#define configTIMER_WHEEL_STACK_SIZE                3072
+
 /* Task */
 #define configMAX_PRIORITIES		                ( 10 )
 #define configUSE_PREEMPTION		                1
@@ -101,6 +106,10 @@
 #define configUSE_TICK_HOOK			                0
 #define configUSE_MALLOC_FAILED_HOOK                ( 1 )
 
+/* Tickless idle, the idle task sleeps through mcu ps, see vPortSuppressTicksAndSleep() */
+#define configUSE_TICKLESS_IDLE                   1
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP     2
+
 /* Memory */
 #define configDYNAMIC_HEAP_SIZE                   1
 #define configTOTAL_HEAP_SIZE		             ( ( size_t ) ( 105 * 1024 ) )
@@ -115,9 +124,40 @@
 #define configUSE_STATS_FORMATTING_FUNCTIONS      1
 #define configUSE_ALTERNATIVE_API 		          0
 #define configCHECK_FOR_STACK_OVERFLOW	          2
-#define configGENERATE_RUN_TIME_STATS	          0
+#define configGENERATE_RUN_TIME_STATS	          1
 #define configUSE_IDLE_SLEEP_HOOK                 ( 1 )
 
+/* run time stats count a free running 26MHz timer, see bk_timer_runtime_init() */
+#define configRUN_TIME_COUNTER_HZ                 26000000
+extern void bk_timer_runtime_init( void );
+extern unsigned int bk_timer_runtime_read( void );
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()  bk_timer_runtime_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()          bk_timer_runtime_read()
+
+/* event tracer, see rtos_trace.h */
+#define configUSE_RTOS_TRACE                      0
+#define configRTOS_TRACE_RECORDS                  1024
+#include "rtos_trace.h"
+
+#define traceTASK_SWITCHED_IN()                   RTOS_TRACE( RTOS_TRACE_TASK_IN, 0, pxCurrentTCB->uxPriority, pxCurrentTCB )
+#define traceTASK_CREATE( pxNewTCB )              RTOS_TRACE( RTOS_TRACE_TASK_CREATE, 0, ( pxNewTCB )->uxPriority, pxNewTCB )
+#define traceTASK_DELAY()                         RTOS_TRACE( RTOS_TRACE_TASK_DELAY, 0, xTicksToDelay, NULL )
+#define traceQUEUE_SEND( pxQueue )                RTOS_TRACE( RTOS_TRACE_QUEUE_SEND, RTOS_TRACE_QUEUE_TYPE( pxQueue ), 0, pxQueue )
+#define traceQUEUE_SEND_FAILED( pxQueue )         RTOS_TRACE( RTOS_TRACE_QUEUE_SEND_FAILED, RTOS_TRACE_QUEUE_TYPE( pxQueue ), 0, pxQueue )
+#define traceQUEUE_RECEIVE( pxQueue )             RTOS_TRACE( RTOS_TRACE_QUEUE_RECEIVE, RTOS_TRACE_QUEUE_TYPE( pxQueue ), 0, pxQueue )
+#define traceQUEUE_RECEIVE_FAILED( pxQueue )      RTOS_TRACE( RTOS_TRACE_QUEUE_RECEIVE_FAILED, RTOS_TRACE_QUEUE_TYPE( pxQueue ), 0, pxQueue )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )    RTOS_TRACE( RTOS_TRACE_QUEUE_BLOCK_SEND, RTOS_TRACE_QUEUE_TYPE( pxQueue ), 0, pxQueue )
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue ) RTOS_TRACE( RTOS_TRACE_QUEUE_BLOCK_RECEIVE, RTOS_TRACE_QUEUE_TYPE( pxQueue ), 0, pxQueue )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )       RTOS_TRACE( RTOS_TRACE_QUEUE_SEND_ISR, RTOS_TRACE_QUEUE_TYPE( pxQueue ), 0, pxQueue )
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )    RTOS_TRACE( RTOS_TRACE_QUEUE_RECEIVE_ISR, RTOS_TRACE_QUEUE_TYPE( pxQueue ), 0, pxQueue )
+#define traceLOW_POWER_IDLE_BEGIN()               RTOS_TRACE( RTOS_TRACE_SLEEP_BEGIN, 0, xExpectedIdleTime, NULL )
+#define traceLOW_POWER_IDLE_END()                 RTOS_TRACE( RTOS_TRACE_SLEEP_END, 0, 0, NULL )
+
+/* slot 0 holds the heap accounting entry of a task, see heap_6.c */
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS   1
+extern void vPortHeapTaskDelete( void *pvTask );
+#define traceTASK_DELETE( pxTCB )                 do { vPortHeapTaskDelete( pxTCB ); RTOS_TRACE( RTOS_TRACE_TASK_DELETE, 0, 0, pxTCB ); } while( 0 )
+
 /* Set the following definitions to 1 to include the API function, or zero
 to exclude the API function. */
 
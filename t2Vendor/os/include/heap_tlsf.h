@@ -0,0 +1,20 @@
+#ifndef _HEAP_TLSF_H_
+#define _HEAP_TLSF_H_
+
+#include "tuya_mem_heap.h"
+
+/*
+ * Two level segregated fit heap, same interface as tuya_mem_heap so heap_6.c
+ * can use either one (configHEAP_TLSF). malloc and free take a bounded
+ * number of steps whatever the fragmentation.
+ */
+int tlsf_heap_init(heap_context_t *ctx);
+int tlsf_heap_create(void *start_addr, unsigned int size, HEAP_HANDLE *handle);
+void *tlsf_heap_malloc(HEAP_HANDLE handle, unsigned int size);
+void *tlsf_heap_realloc(HEAP_HANDLE handle, void *ptr, unsigned int size);
+void tlsf_heap_free(HEAP_HANDLE handle, void *ptr);
+int tlsf_heap_available(HEAP_HANDLE handle);
+
+#endif // _HEAP_TLSF_H_
+
+// EOF
@@ -24,6 +24,182 @@ void os_free(void *ptr);
 void *os_zalloc(size_t size);
 #endif
 
+/*
+ * heap selection for os_malloc_heap(). the fast heap sits in tcm, single cycle
+ * for the cpu; use it for small hot buffers.
+ */
+#define OS_HEAP_MAIN        0
+#define OS_HEAP_FAST        1
+#define OS_HEAP_NUM         2
+#define OS_HEAP_ID_MASK     0xFF
+#define OS_HEAP_NO_SPILL    0x100   /* fail instead of falling back to the other heap */
+#define OS_HEAP_NO_SLAB     0x200   /* skip the slab classes, take the block from the heap */
+
+void *os_malloc_heap(size_t size, UINT32 flags);
+void *os_malloc_fast(size_t size);
+void *os_zalloc_fast(size_t size);
+/* heap a block lives in, free with os_free() whatever the heap */
+int os_heap_of(const void *ptr);
+/* bytes the caller may use in a block, at least what was asked for; 0 when not known */
+size_t os_malloc_usable_size(void *ptr);
+
+/* heap telemetry, see heap_6.c */
+#define OS_HEAP_SITE_NUM    32
+#define OS_HEAP_HIST_NUM    12      /* free block classes <32, <64, ... <32K, >=32K */
+#define OS_HEAP_PROBE_MAX   32
+
+typedef struct
+{
+    UINT32 total_size;
+    UINT32 free_size;
+    UINT32 min_ever_free;   /* high-water mark of the heap */
+    UINT32 used_size;       /* requested bytes in use */
+    UINT32 peak_used;
+    UINT32 blocks;          /* live allocations */
+    UINT32 alloc_count;
+    UINT32 free_count;
+    UINT32 fail_count;
+    UINT32 spill_count;     /* allocations that landed here because the other heap was full */
+    UINT32 bad_free;        /* frees of a pointer that is not a live block */
+} os_heap_stat_t;
+
+typedef struct
+{
+    const void *site;       /* caller address, or function name when line is not 0 */
+    UINT32 line;
+    UINT32 bytes;
+    UINT32 blocks;
+    UINT32 peak_bytes;
+} os_heap_site_t;
+
+typedef struct
+{
+    UINT32 largest_free;
+    UINT32 free_blocks;     /* probed free blocks, at most OS_HEAP_PROBE_MAX */
+    UINT32 fragmentation;   /* percent of free memory outside the largest block */
+    UINT32 hist[OS_HEAP_HIST_NUM];
+} os_heap_frag_t;
+
+/* per task heap use, see configHEAP_TASK_STAT in heap_6.c */
+#define OS_HEAP_TASK_NUM        24
+#define OS_HEAP_TASK_NAME_LEN   16
+
+typedef struct
+{
+    char name[OS_HEAP_TASK_NAME_LEN];
+    void *task;             /* NULL once the task is deleted */
+    UINT32 bytes;
+    UINT32 blocks;
+    UINT32 peak_bytes;
+    UINT32 soft_limit;      /* 0 for none */
+    UINT32 hard_limit;      /* 0 for none, allocations beyond it fail */
+    UINT32 over_soft;       /* allocations that went over the soft limit */
+    UINT32 fail_count;      /* allocations refused by the hard limit */
+} os_heap_task_t;
+
+void os_heap_get_stat(int heap, os_heap_stat_t *stat);
+int os_heap_get_sites(os_heap_site_t *sites, int max);
+/* walks the free memory by allocating it, keep it out of time critical paths */
+void os_heap_get_frag(int heap, os_heap_frag_t *frag);
+void os_heap_reset_peak(void);
+void os_heap_dump(void);
+/* task NULL is the caller, the limits are in requested bytes */
+int os_heap_task_set_limit(void *task, UINT32 soft_limit, UINT32 hard_limit);
+UINT32 os_heap_task_bytes(void *task);
+int os_heap_get_tasks(os_heap_task_t *tasks, int max);
+
+/* guard words and a background check, compiled in with configHEAP_CHECK, see heap_6.c */
+typedef struct
+{
+    UINT32 passes;          /* walks over all live blocks */
+    UINT32 blocks;          /* blocks checked */
+    UINT32 steps;           /* idle hook calls that checked blocks */
+    UINT32 total_us;        /* time spent in them, wraps */
+    UINT32 max_us;          /* longest one */
+    void *bad_block;        /* first corrupt block, NULL while none was found */
+    const char *what;       /* "header", "overrun" or "link" */
+    UINT32 bad_size;
+    const void *site;       /* where bad_block was allocated, as in os_heap_site_t */
+    UINT32 line;
+} os_heap_check_stat_t;
+
+/* checks every block now, 0 once a corrupt block was found; always 1 when compiled out */
+int os_heap_check(void);
+void os_heap_check_get_stat(os_heap_check_stat_t *stat);
+
+/* allocation trace, compiled in with configHEAP_TRACE, see heap_6.c */
+#define OS_HEAP_TRACE_ALLOC         1
+#define OS_HEAP_TRACE_FREE          2
+#define OS_HEAP_TRACE_REALLOC       3   /* old 0 is a malloc, size 0 a free */
+
+#define OS_HEAP_TRACE_TASK_NUM      16
+#define OS_HEAP_TRACE_TASK_OTHER    0xFF    /* the task table was full */
+
+typedef struct
+{
+    UINT32 stamp;       /* microseconds, wraps */
+    UINT32 ptr;         /* the block, 0 when the allocation failed */
+    UINT32 old;         /* the block given to realloc */
+    UINT32 size;        /* requested size */
+    UINT8 op;
+    UINT8 task;         /* 0 for an isr or before the scheduler runs, see os_heap_trace_task() */
+    UINT8 heap;
+    UINT8 reserved;
+} os_heap_trace_t;
+
+/* clears the ring and starts recording */
+void os_heap_trace_start(void);
+void os_heap_trace_stop(void);
+/* takes the oldest records out of the ring, returns how many */
+int os_heap_trace_read(os_heap_trace_t *recs, int max);
+/* records dropped because the ring was full */
+UINT32 os_heap_trace_lost(void);
+const char *os_heap_trace_task(int task);
+void os_heap_trace_dump(void);
+/* a pool block handed out or taken back by mem_slab.c without the heap */
+void os_heap_trace_pool(UINT8 op, const void *ptr, UINT32 size);
+
+/*
+ * slab classes and fixed size pools, see mem_slab.c. main heap requests up to
+ * 96 bytes come from the slab classes unless OS_HEAP_NO_SLAB is given or the
+ * build sets OS_SLAB_CLASSES to other classes or OS_SLAB_CLASSES_OFF. blocks
+ * of both are freed with os_free() like any other block.
+ */
+#define OS_POOL_MAX         8
+
+typedef struct os_pool os_pool_t;
+
+typedef struct
+{
+    const char *name;       /* NULL for the os_malloc() slab classes */
+    UINT32 block_size;
+    UINT32 block_count;
+    UINT32 free_count;
+    UINT32 min_free;        /* fewest free blocks seen */
+    UINT32 alloc_count;
+    UINT32 fallback_count;  /* requests passed on to the heap, the pool was empty */
+} os_pool_stat_t;
+
+/* os_slab_free() tag of a pool block, only slab class blocks carry one */
+#define OS_SLAB_NO_TAG      0xFFFF
+
+/*
+ * used by the heap, NULL or 0 when ptr or size is not for the slab. tag is
+ * kept with the block and handed back by os_slab_free(), which returns -1 for
+ * a double free or a pointer into the middle of a block and leaves it alone.
+ */
+void *os_slab_alloc(size_t size, UINT16 tag);
+int os_slab_free(void *ptr, UINT16 *tag);
+UINT32 os_slab_block_size(const void *ptr);
+
+/* a pool for one subsystem, os_pool_alloc() falls back to os_malloc() once it is empty */
+os_pool_t *os_pool_create(const char *name, UINT32 block_size, UINT32 block_count);
+void *os_pool_alloc(os_pool_t *pool);
+void os_pool_free(os_pool_t *pool, void *ptr);
+/* slab classes come first, then the pools in creation order; 0 past the last one */
+int os_pool_get_stat(int index, os_pool_stat_t *stat);
+void os_slab_dump(void);
+
 #endif // _MEM_PUB_H_
 
 // EOF
@@ -53,6 +53,25 @@ typedef void *          beken_thread_t;
 typedef void *          beken_queue_t;
 typedef void *          beken_event_t;        //  OS event: beken_semaphore_t, beken_mutex_t or beken_queue_t
 
+#define RTOS_CPU_TASK_NUM                  32
+#define RTOS_CPU_NAME_LEN                  16
+
+typedef struct
+{
+    uint16_t load_1s;       /* per mille */
+    uint16_t load_10s;
+    uint32_t samples;       /* periods sampled, the 10s window is shorter until there are 10 */
+    uint32_t read_ns;       /* run time counter read, done on every context switch */
+} rtos_cpu_load_t;
+
+typedef struct
+{
+    char     name[RTOS_CPU_NAME_LEN];
+    void    *task;
+    uint16_t load_1s;       /* per mille */
+    uint16_t load_10s;
+} rtos_cpu_task_t;
+
 typedef enum
 {
     WAIT_FOR_ANY_EVENT,
@@ -301,6 +320,33 @@ OSStatus rtos_delay_milliseconds( uint32_t num_ms );
   */
 OSStatus rtos_print_thread_status( char* buffer, int length );
 
+/** @brief    Start sampling the cpu load, once a second from the timer task
+  *
+  * @note     The first period is complete one second after this. The cost of
+  *           one run time counter read, paid on every context switch, is
+  *           measured here.
+  *
+  * @return   kNoErr, or kUnsupportedErr without configGENERATE_RUN_TIME_STATS
+  */
+OSStatus rtos_cpu_load_start( void );
+
+/** @brief    Cpu load of the whole system, everything but the idle task
+  *
+  * @param    load : loads in per mille of the last second and the last 10 seconds
+  *
+  * @return   kNoErr, or kUnsupportedErr without configGENERATE_RUN_TIME_STATS
+  */
+OSStatus rtos_get_cpu_load( rtos_cpu_load_t *load );
+
+/** @brief    Cpu load of each task, same windows as rtos_get_cpu_load()
+  *
+  * @param    tasks : array to fill
+  * @param    max   : size of the array
+  *
+  * @return   number of tasks filled in
+  */
+int rtos_get_cpu_tasks( rtos_cpu_task_t *tasks, int max );
+
 /**
   * @}
   */
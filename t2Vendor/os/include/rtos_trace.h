@@ -0,0 +1,145 @@
+#ifndef _RTOS_TRACE_H_
+#define _RTOS_TRACE_H_
+
+/*
+ * Event tracer. The FreeRTOS trace hooks (FreeRTOSConfig.h), the interrupt
+ * dispatcher and tkl_mutex/tkl_queue write 12 byte records stamped with the
+ * 26MHz run time counter into a ram ring. The ring is either streamed to a
+ * uart by a low priority task or kept as a flight recorder and saved to flash
+ * on demand. tools/rtos_trace.py turns either output into a chrome trace.
+ *
+ * configUSE_RTOS_TRACE in FreeRTOSConfig.h builds it in. Compiled in but
+ * stopped, a hook costs one load and a branch.
+ */
+
+#include <stdint.h>
+#include "FreeRTOSConfig.h"
+
+#ifndef configUSE_RTOS_TRACE
+#define configUSE_RTOS_TRACE            0
+#endif
+
+/* ring size in records, a power of 2 */
+#ifndef configRTOS_TRACE_RECORDS
+#define configRTOS_TRACE_RECORDS        1024
+#endif
+
+/* area of rtos_trace_save(), erased on every save. there is no spare area in
+   the flash map, so it has to be given at build time to a region the
+   application does not need (not the ota partition, which may hold an image
+   waiting to be applied); without it rtos_trace_save() is not supported */
+#if defined(RTOS_TRACE_FLASH_ADDR) && !defined(RTOS_TRACE_FLASH_SIZE)
+#define RTOS_TRACE_FLASH_SIZE           0x10000
+#endif
+
+/* record types */
+#define RTOS_TRACE_TASK_IN              1   /* obj task, arg16 priority */
+#define RTOS_TRACE_TASK_CREATE          2   /* obj task, arg16 priority */
+#define RTOS_TRACE_TASK_DELETE          3   /* obj task */
+#define RTOS_TRACE_TASK_DELAY           4   /* arg16 ticks */
+#define RTOS_TRACE_QUEUE_SEND           5   /* obj queue, arg8 queue type */
+#define RTOS_TRACE_QUEUE_SEND_FAILED    6
+#define RTOS_TRACE_QUEUE_RECEIVE        7
+#define RTOS_TRACE_QUEUE_RECEIVE_FAILED 8
+#define RTOS_TRACE_QUEUE_BLOCK_SEND     9
+#define RTOS_TRACE_QUEUE_BLOCK_RECEIVE  10
+#define RTOS_TRACE_QUEUE_SEND_ISR       11
+#define RTOS_TRACE_QUEUE_RECEIVE_ISR    12
+#define RTOS_TRACE_ISR_ENTER            13  /* arg8 interrupt number */
+#define RTOS_TRACE_ISR_EXIT             14
+#define RTOS_TRACE_SLEEP_BEGIN          15  /* tickless idle */
+#define RTOS_TRACE_SLEEP_END            16
+#define RTOS_TRACE_MUTEX_LOCK           17  /* obj mutex, tkl_mutex_lock() starts waiting */
+#define RTOS_TRACE_MUTEX_LOCKED         18  /* arg8 1 on success */
+#define RTOS_TRACE_MUTEX_UNLOCK         19
+#define RTOS_TRACE_TKL_POST             20  /* obj queue, arg8 1 on success */
+#define RTOS_TRACE_TKL_FETCH            21  /* tkl_queue_fetch() starts waiting */
+#define RTOS_TRACE_TKL_FETCHED          22  /* arg8 1 on success */
+#define RTOS_TRACE_USER                 23  /* arg16 id, obj value */
+#define RTOS_TRACE_DROPPED              24  /* obj records lost while streaming */
+
+/* arg8 of the queue records, matches queueQUEUE_TYPE_* */
+#define RTOS_TRACE_QUEUE_TYPE(q)        ((q)->ucQueueType)
+
+#if configUSE_RTOS_TRACE
+extern volatile unsigned char rtos_trace_on;
+extern void rtos_trace_event(unsigned char type, unsigned char arg8, unsigned int arg16, const void *obj);
+
+#define RTOS_TRACE(type, arg8, arg16, obj) \
+    do { if(rtos_trace_on) rtos_trace_event((type), (unsigned char)(arg8), (unsigned int)(arg16), (const void *)(obj)); } while(0)
+#else
+#define RTOS_TRACE(type, arg8, arg16, obj)
+#endif
+
+typedef struct
+{
+    uint32_t ts;            /* run time counter */
+    uint8_t  type;
+    uint8_t  arg8;
+    uint16_t arg16;
+    uint32_t obj;
+} rtos_trace_rec_t;
+
+/*
+ * Output format, little endian, the same for uart and flash: a header, then
+ * chunks. A chunk is {sync, count} followed by count items; a reader that
+ * sees something else (log text on a shared uart, erased flash) skips ahead
+ * to the next sync.
+ */
+#define RTOS_TRACE_MAGIC                0x43525452  /* "RTRC" */
+#define RTOS_TRACE_VERSION              1
+#define RTOS_TRACE_SYNC_REC             0x5254      /* "TR", rtos_trace_rec_t */
+#define RTOS_TRACE_SYNC_NAME            0x4e54      /* "TN", rtos_trace_name_t */
+#define RTOS_TRACE_NAME_LEN             16
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rec_size;
+    uint32_t ts_hz;
+    uint32_t records;       /* ring size */
+} rtos_trace_head_t;
+
+typedef struct
+{
+    uint16_t sync;
+    uint16_t count;
+} rtos_trace_chunk_t;
+
+typedef struct
+{
+    uint32_t task;
+    char     name[RTOS_TRACE_NAME_LEN];
+} rtos_trace_name_t;
+
+enum
+{
+    RTOS_TRACE_MODE_RING = 0,   /* flight recorder, the oldest record is overwritten */
+    RTOS_TRACE_MODE_STREAM,     /* records wait for the stream task, new ones are dropped when full */
+};
+
+typedef struct
+{
+    uint32_t written;
+    uint32_t dropped;       /* lost in stream mode */
+    uint32_t overwritten;   /* lost in ring mode */
+    uint32_t pending;       /* in the ring now */
+} rtos_trace_stat_t;
+
+#if configUSE_RTOS_TRACE
+int rtos_trace_start(int mode);
+void rtos_trace_stop(void);
+/* marker for the timeline, e.g. around loop() */
+void rtos_trace_user(uint16_t id, uint32_t value);
+/* start tracing in stream mode and send the ring to a uart (bk_uart_t) */
+int rtos_trace_stream(int uart);
+/* write the ring to RTOS_TRACE_FLASH_ADDR, tracing pauses meanwhile;
+   kUnsupportedErr when the build sets no address */
+int rtos_trace_save(void);
+void rtos_trace_get_stat(rtos_trace_stat_t *stat);
+#endif
+
+#endif // _RTOS_TRACE_H_
+
+// EOF
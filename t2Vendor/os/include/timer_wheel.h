@@ -0,0 +1,87 @@
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+/*
+ * Software timers on a hierarchical timer wheel, run by a worker task of
+ * their own instead of the FreeRTOS timer service task.
+ *
+ * Start, stop and expiry are O(1): a timer goes into one of 64 slots of the
+ * level its timeout falls in (64 ticks apart per level, 5 levels), and a slot
+ * of a higher level is moved down a level when the wheel comes to it. There
+ * is no command queue to overflow, start and stop work on the wheel directly
+ * under a short interrupt lock and may be called from interrupts. The worker
+ * sleeps until the next slot with timers, so it does not keep the cpu out of
+ * tickless idle, and runs the callbacks of a tick as one batch.
+ *
+ * Timeouts are in ms and rounded up to whole ticks. Callbacks due on the same
+ * tick run in no particular order. Timeouts past 2^30 ticks (24 days) work,
+ * the timer is just moved down the wheel once more.
+ *
+ * configUSE_TIMER_WHEEL in FreeRTOSConfig.h routes rtos_init_timer() and the
+ * rest of the beken_timer_t/beken2_timer_t calls here.
+ */
+
+#include <stdint.h>
+#include "FreeRTOSConfig.h"
+
+#ifndef configUSE_TIMER_WHEEL
+#define configUSE_TIMER_WHEEL               0
+#endif
+
+/* worker of timer_wheel_init(), the same as the timer service task by default */
+#ifndef configTIMER_WHEEL_TASK_PRIORITY
+#define configTIMER_WHEEL_TASK_PRIORITY     configTIMER_TASK_PRIORITY
+#endif
+#ifndef configTIMER_WHEEL_STACK_SIZE
+#define configTIMER_WHEEL_STACK_SIZE        3072
+#endif
+
+typedef void (*timer_wheel_handler_t)(void *larg, void *rarg);
+
+/* owned by the wheel between timer_wheel_init_timer() and timer_wheel_deinit_timer() */
+typedef struct timer_wheel_timer
+{
+    struct timer_wheel_timer *next;
+    struct timer_wheel_timer **pprev;   /* NULL when not active */
+    uint32_t expiry;                    /* tick */
+    uint32_t period;                    /* ticks */
+    timer_wheel_handler_t function;
+    void *larg;
+    void *rarg;
+    uint8_t periodic;
+} timer_wheel_timer_t;
+
+typedef struct
+{
+    uint32_t active;
+    uint32_t fired;
+    uint32_t cascaded;      /* timers moved down a level */
+    uint32_t max_batch;     /* most callbacks of one tick */
+    uint32_t max_late;      /* ticks from expiry to callback, worst seen */
+} timer_wheel_stat_t;
+
+/* start the worker, the first timer_wheel_init_timer() does it with the config defaults */
+int timer_wheel_init(uint32_t priority, uint32_t stack_size);
+
+void timer_wheel_init_timer(timer_wheel_timer_t *timer, uint32_t time_ms, int periodic,
+                            timer_wheel_handler_t function, void *larg, void *rarg);
+/* stops the timer, its callback may still be running in the worker; NULL is ignored */
+void timer_wheel_deinit_timer(timer_wheel_timer_t *timer);
+
+/* (re)start, the timer expires one period from now */
+int timer_wheel_start(timer_wheel_timer_t *timer);
+int timer_wheel_stop(timer_wheel_timer_t *timer);
+/* set a new period and restart */
+int timer_wheel_change_period(timer_wheel_timer_t *timer, uint32_t time_ms);
+int timer_wheel_is_active(timer_wheel_timer_t *timer);
+/* tick the timer expires at */
+uint32_t timer_wheel_get_expiry(timer_wheel_timer_t *timer);
+/* tick the first timer expires at, portMAX_DELAY when the wheel is empty */
+uint32_t timer_wheel_next_expiry(void);
+
+void timer_wheel_get_stat(timer_wheel_stat_t *stat);
+void timer_wheel_dump(void);
+
+#endif // _TIMER_WHEEL_H_
+
+// EOF
@@ -27,25 +27,12 @@ void *os_memset(void *b, int c, UINT32 len)
 
 void *os_realloc(void *ptr, size_t size)
 {
-	#ifdef FIX_REALLOC_ISSUE
-    return pvPortRealloc(ptr, size);
-	#else
-	void *tmp;
-
     if(platform_is_in_interrupt_context())
     {
         os_printf("realloc_risk\r\n");
     }
 
-	tmp = (void *)pvPortMalloc(size);
-	if(tmp)
-	{
-		os_memcpy(tmp, ptr, size);
-		vPortFree(ptr);
-	}
-
-	return tmp;
-	#endif
+    return pvPortRealloc(ptr, size);
 }
 
 int os_memcmp_const(const void *a, const void *b, size_t len)
@@ -61,12 +48,12 @@ void *os_malloc(size_t size)
         os_printf("malloc_risk\r\n");
     }
     
-    return (void *)pvPortMalloc(size);
+    return (void *)pvPortMallocTrace(size, __builtin_return_address(0), 0);
 }
 
 void * os_zalloc(size_t size)
 {
-	void *n = (void *)pvPortMalloc(size);
+	void *n = (void *)pvPortMallocTrace(size, __builtin_return_address(0), 0);
     
     if(platform_is_in_interrupt_context())
     {
@@ -0,0 +1,447 @@
+#include "include.h"
+#include "arm_arch.h"
+#include <string.h>
+
+#include "sys_rtos.h"
+#include "uart_pub.h"
+#include "mem_pub.h"
+
+/*
+ * Slab classes for small blocks. os_malloc() requests up to the largest class
+ * are taken from fixed size free lists and only go to the heap once their
+ * class is empty. Each entry is {block size, block count}, sizes ascending and
+ * multiples of 8.
+ *
+ * The classes hold their whole arena whether it is used or not, so the
+ * default table is kept small: 4 KB of the 192 KB heap for short String
+ * buffers and rtos handles (a tal_mutex is about 80 bytes). An application
+ * can size its own from os_slab_dump(), e.g.
+ *   -DOS_SLAB_CLASSES="{16, 64}, {32, 32}, {64, 16}, {128, 8}"
+ * or build with OS_SLAB_CLASSES_OFF to leave every block to the heap.
+ */
+#if !defined(OS_SLAB_CLASSES) && !defined(OS_SLAB_CLASSES_OFF)
+#define OS_SLAB_CLASSES     {16, 32}, {32, 32}, {64, 16}, {96, 16}
+#endif
+
+typedef struct
+{
+    UINT16 block_size;
+    UINT16 block_count;
+} slab_class_cfg_t;
+
+/* a free block holds the next free block in its first word */
+struct os_pool
+{
+    const char *name;
+    UINT8 *start;
+    UINT8 *end;
+    void *free_list;
+    UINT32 *used;           /* a bit per block, set while it is allocated */
+    UINT16 *tag;            /* per block, slab classes only */
+    UINT32 block_size;
+    UINT32 block_count;
+    UINT32 free_count;
+    UINT32 min_free;
+    UINT32 alloc_count;
+    UINT32 fallback_count;
+};
+
+#ifndef OS_SLAB_CLASSES_OFF
+static const slab_class_cfg_t s_slab_cfg[] = {OS_SLAB_CLASSES};
+#define SLAB_CLASS_NUM      (sizeof(s_slab_cfg) / sizeof(s_slab_cfg[0]))
+#else
+static const slab_class_cfg_t s_slab_cfg[1] = {{0, 0}};
+#define SLAB_CLASS_NUM      0
+#endif
+
+#define SLAB_USED_WORDS(count)      (((count) + 31) / 32)
+
+enum
+{
+    SLAB_STATE_NONE = 0,
+    SLAB_STATE_INIT,
+    SLAB_STATE_READY,
+};
+
+static struct os_pool s_slab[SLAB_CLASS_NUM ? SLAB_CLASS_NUM : 1];
+/* all classes share one arena */
+static UINT8 *s_slab_start = NULL;
+static UINT8 *s_slab_end = NULL;
+static volatile UINT32 s_slab_state = SLAB_STATE_NONE;
+
+static struct os_pool s_pools[OS_POOL_MAX];
+static volatile UINT32 s_pool_num = 0;
+
+static void slab_pool_init(struct os_pool *pool, const char *name, UINT8 *arena,
+                           UINT32 block_size, UINT32 block_count, UINT32 *used, UINT16 *tag)
+{
+    UINT32 i;
+
+    pool->name = name;
+    pool->start = arena;
+    pool->end = arena + block_size * block_count;
+    pool->block_size = block_size;
+    pool->block_count = block_count;
+    pool->used = used;
+    pool->tag = tag;
+    memset(used, 0, SLAB_USED_WORDS(block_count) * sizeof(UINT32));
+    pool->free_list = NULL;
+    for(i = block_count; i > 0; i--)
+    {
+        *(void **)(arena + (i - 1) * block_size) = pool->free_list;
+        pool->free_list = arena + (i - 1) * block_size;
+    }
+    pool->free_count = block_count;
+    pool->min_free = block_count;
+    pool->alloc_count = 0;
+    pool->fallback_count = 0;
+}
+
+/* interrupts disabled */
+static void *slab_pool_take(struct os_pool *pool)
+{
+    void *pv = pool->free_list;
+    UINT32 i;
+
+    if(NULL == pv)
+    {
+        pool->fallback_count ++;
+        return NULL;
+    }
+
+    pool->free_list = *(void **)pv;
+    i = ((UINT8 *)pv - pool->start) / pool->block_size;
+    pool->used[i / 32] |= 1u << (i % 32);
+    pool->free_count --;
+    if(pool->free_count < pool->min_free)
+    {
+        pool->min_free = pool->free_count;
+    }
+    pool->alloc_count ++;
+
+    return pv;
+}
+
+/* false for a pointer into the middle of a block or a block that is not allocated */
+static int slab_pool_give(struct os_pool *pool, void *pv, UINT16 *tag)
+{
+    UINT32 i, bit;
+    GLOBAL_INT_DECLARATION();
+
+    if(0 != ((UINT8 *)pv - pool->start) % pool->block_size)
+    {
+        os_printf("slab: bad free %p\r\n", pv);
+        return 0;
+    }
+
+    i = ((UINT8 *)pv - pool->start) / pool->block_size;
+    bit = 1u << (i % 32);
+
+    GLOBAL_INT_DISABLE();
+    /* on the free list already, linking it again would hand it out twice */
+    if(0 == (pool->used[i / 32] & bit))
+    {
+        GLOBAL_INT_RESTORE();
+        os_printf("slab: double free %p\r\n", pv);
+        return 0;
+    }
+    pool->used[i / 32] &= ~bit;
+    if(tag)
+    {
+        *tag = pool->tag ? pool->tag[i] : OS_SLAB_NO_TAG;
+    }
+    *(void **)pv = pool->free_list;
+    pool->free_list = pv;
+    pool->free_count ++;
+    GLOBAL_INT_RESTORE();
+
+    return 1;
+}
+
+static struct os_pool *slab_pool_of(const void *ptr)
+{
+    const UINT8 *pv = (const UINT8 *)ptr;
+    UINT32 i, num;
+
+    if(pv >= s_slab_start && pv < s_slab_end)
+    {
+        for(i = 0; i < SLAB_CLASS_NUM; i++)
+        {
+            if(pv < s_slab[i].end)
+            {
+                return &s_slab[i];
+            }
+        }
+    }
+
+    num = s_pool_num;
+    for(i = 0; i < num; i++)
+    {
+        if(pv >= s_pools[i].start && pv < s_pools[i].end)
+        {
+            return &s_pools[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void slab_init(void)
+{
+    UINT32 i, size = 0, words = 0, blocks = 0;
+    UINT8 *arena;
+    UINT32 *used;
+    UINT16 *tag;
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    if(SLAB_STATE_NONE != s_slab_state)
+    {
+        GLOBAL_INT_RESTORE();
+        return;
+    }
+    s_slab_state = SLAB_STATE_INIT;
+    GLOBAL_INT_RESTORE();
+
+    for(i = 0; i < SLAB_CLASS_NUM; i++)
+    {
+        size += s_slab_cfg[i].block_size * s_slab_cfg[i].block_count;
+        words += SLAB_USED_WORDS(s_slab_cfg[i].block_count);
+        blocks += s_slab_cfg[i].block_count;
+    }
+
+    /* without an arena the slab stays off and everything goes to the heap */
+    arena = (UINT8 *)pvPortMallocHeap(size + words * sizeof(UINT32) + blocks * sizeof(UINT16),
+                                      OS_HEAP_MAIN | OS_HEAP_NO_SLAB, __FUNCTION__, __LINE__);
+    if(NULL == arena)
+    {
+        os_printf("slab: no arena for %d bytes\r\n", size);
+        return;
+    }
+
+    /* the blocks, then the bitmaps and the tags of all classes */
+    used = (UINT32 *)(arena + size);
+    tag = (UINT16 *)(used + words);
+
+    s_slab_start = arena;
+    for(i = 0; i < SLAB_CLASS_NUM; i++)
+    {
+        slab_pool_init(&s_slab[i], NULL, arena, s_slab_cfg[i].block_size, s_slab_cfg[i].block_count,
+                       used, tag);
+        arena += s_slab_cfg[i].block_size * s_slab_cfg[i].block_count;
+        used += SLAB_USED_WORDS(s_slab_cfg[i].block_count);
+        tag += s_slab_cfg[i].block_count;
+    }
+    s_slab_end = arena;
+
+    s_slab_state = SLAB_STATE_READY;
+}
+
+void *os_slab_alloc(size_t size, UINT16 tag)
+{
+    struct os_pool *pool;
+    void *pv = NULL;
+    UINT32 i;
+    GLOBAL_INT_DECLARATION();
+
+    if(0 == SLAB_CLASS_NUM)
+    {
+        return NULL;
+    }
+
+    if(SLAB_STATE_READY != s_slab_state)
+    {
+        slab_init();
+        if(SLAB_STATE_READY != s_slab_state)
+        {
+            return NULL;
+        }
+    }
+
+    for(i = 0; i < SLAB_CLASS_NUM; i++)
+    {
+        if(size <= s_slab[i].block_size)
+        {
+            pool = &s_slab[i];
+            GLOBAL_INT_DISABLE();
+            pv = slab_pool_take(pool);
+            if(pv)
+            {
+                pool->tag[((UINT8 *)pv - pool->start) / pool->block_size] = tag;
+            }
+            GLOBAL_INT_RESTORE();
+            break;
+        }
+    }
+
+    return pv;
+}
+
+int os_slab_free(void *ptr, UINT16 *tag)
+{
+    struct os_pool *pool = slab_pool_of(ptr);
+
+    if(NULL == pool)
+    {
+        return 0;
+    }
+
+    return slab_pool_give(pool, ptr, tag) ? 1 : -1;
+}
+
+UINT32 os_slab_block_size(const void *ptr)
+{
+    struct os_pool *pool = slab_pool_of(ptr);
+
+    return (NULL == pool) ? 0 : pool->block_size;
+}
+
+os_pool_t *os_pool_create(const char *name, UINT32 block_size, UINT32 block_count)
+{
+    struct os_pool *pool = NULL;
+    UINT8 *arena;
+    UINT32 size;
+    GLOBAL_INT_DECLARATION();
+
+    if(0 == block_count || s_pool_num >= OS_POOL_MAX)
+    {
+        return NULL;
+    }
+
+    /* room for the free list link, and keep every block 8 byte aligned */
+    if(block_size < sizeof(void *))
+    {
+        block_size = sizeof(void *);
+    }
+    block_size = (block_size + 7) & ~7;
+
+    size = block_size * block_count;
+    arena = (UINT8 *)pvPortMallocHeap(size + SLAB_USED_WORDS(block_count) * sizeof(UINT32),
+                                      OS_HEAP_MAIN | OS_HEAP_NO_SLAB, __builtin_return_address(0), 0);
+    if(NULL == arena)
+    {
+        return NULL;
+    }
+
+    GLOBAL_INT_DISABLE();
+    if(s_pool_num < OS_POOL_MAX)
+    {
+        pool = &s_pools[s_pool_num];
+        slab_pool_init(pool, name, arena, block_size, block_count, (UINT32 *)(arena + size), NULL);
+        s_pool_num ++;
+    }
+    GLOBAL_INT_RESTORE();
+
+    if(NULL == pool)
+    {
+        vPortFree(arena);
+    }
+
+    return pool;
+}
+
+void *os_pool_alloc(os_pool_t *pool)
+{
+    void *pv;
+    GLOBAL_INT_DECLARATION();
+
+    if(NULL == pool)
+    {
+        return NULL;
+    }
+
+    GLOBAL_INT_DISABLE();
+    pv = slab_pool_take(pool);
+    GLOBAL_INT_RESTORE();
+
+    /* the heap traces its own blocks, pool blocks go in the same trace so their os_free() pairs up */
+    if(NULL == pv)
+    {
+        pv = pvPortMallocHeap(pool->block_size, OS_HEAP_MAIN, __builtin_return_address(0), 0);
+    }
+    else
+    {
+        os_heap_trace_pool(OS_HEAP_TRACE_ALLOC, pv, pool->block_size);
+    }
+
+    return pv;
+}
+
+void os_pool_free(os_pool_t *pool, void *ptr)
+{
+    if(NULL == ptr)
+    {
+        return;
+    }
+
+    if(NULL != pool && (UINT8 *)ptr >= pool->start && (UINT8 *)ptr < pool->end)
+    {
+        /* recorded first, like vPortFree(): once given back the block may be taken and traced again */
+        os_heap_trace_pool(OS_HEAP_TRACE_FREE, ptr, 0);
+        slab_pool_give(pool, ptr, NULL);
+        return;
+    }
+
+    vPortFree(ptr);
+}
+
+int os_pool_get_stat(int index, os_pool_stat_t *stat)
+{
+    struct os_pool *pool;
+    GLOBAL_INT_DECLARATION();
+
+    if(NULL == stat || index < 0)
+    {
+        return 0;
+    }
+
+    if(index < SLAB_CLASS_NUM)
+    {
+        if(SLAB_STATE_READY != s_slab_state)
+        {
+            return 0;
+        }
+        pool = &s_slab[index];
+    }
+    else if(index - SLAB_CLASS_NUM < s_pool_num)
+    {
+        pool = &s_pools[index - SLAB_CLASS_NUM];
+    }
+    else
+    {
+        return 0;
+    }
+
+    GLOBAL_INT_DISABLE();
+    stat->name = pool->name;
+    stat->block_size = pool->block_size;
+    stat->block_count = pool->block_count;
+    stat->free_count = pool->free_count;
+    stat->min_free = pool->min_free;
+    stat->alloc_count = pool->alloc_count;
+    stat->fallback_count = pool->fallback_count;
+    GLOBAL_INT_RESTORE();
+
+    return 1;
+}
+
+void os_slab_dump(void)
+{
+    os_pool_stat_t stat;
+    int i;
+
+    for(i = 0; i < SLAB_CLASS_NUM + OS_POOL_MAX; i++)
+    {
+        if(!os_pool_get_stat(i, &stat))
+        {
+            continue;
+        }
+
+        os_printf("%s %-8s %4d: free %d/%d min %d allocs %d fallbacks %d\r\n",
+                  stat.name ? "pool" : "slab", stat.name ? stat.name : "",
+                  stat.block_size, stat.free_count, stat.block_count, stat.min_free,
+                  stat.alloc_count, stat.fallback_count);
+    }
+}
+
+// EOF
@@ -26,13 +26,13 @@
 /************** wrap C library functions **************/
 void * __wrap_malloc (size_t size)
 {
-	return os_malloc(size);
+	return pvPortMallocTrace(size, __builtin_return_address(0), 0);
 }
 
 void * __wrap__malloc_r (void *p, size_t size)
 {
 	
-	return os_malloc(size);
+	return pvPortMallocTrace(size, __builtin_return_address(0), 0);
 }
 
 void __wrap_free (void *pv)
@@ -44,7 +44,7 @@ void * __wrap_calloc (size_t a, size_t b)
 {
 	void *pvReturn;
 
-    pvReturn = os_malloc( a*b );
+    pvReturn = pvPortMallocTrace( a*b, __builtin_return_address(0), 0 );
     if (pvReturn)
     {
         os_memset(pvReturn, 0, a*b);
@@ -58,6 +58,11 @@ void * __wrap_realloc (void* pv, size_t size)
 	return pvPortRealloc(pv, size);
 }
 
+size_t __wrap_malloc_usable_size (void *pv)
+{
+	return xPortGetUsableSize(pv);
+}
+
 void __wrap__free_r (void *p, void *x)
 {
   __wrap_free(x);
@@ -0,0 +1,382 @@
+#include "include.h"
+#include "arm_arch.h"
+#include <string.h>
+
+#include "sys_rtos.h"
+#include "task.h"
+#include "rtos_pub.h"
+#include "uart_pub.h"
+#include "mem_pub.h"
+#include "BkDriverUart.h"
+#include "tkl_flash.h"
+#include "rtos_trace.h"
+
+#if configUSE_RTOS_TRACE
+
+#if (configRTOS_TRACE_RECORDS & (configRTOS_TRACE_RECORDS - 1)) || (configRTOS_TRACE_RECORDS > 0xFFFF)
+#error configRTOS_TRACE_RECORDS must be a power of 2 below 65536
+#endif
+
+/* records are stamped with the run time counter, it only runs with the stats */
+#if !configGENERATE_RUN_TIME_STATS
+#error configUSE_RTOS_TRACE needs configGENERATE_RUN_TIME_STATS
+#endif
+
+#define TRACE_MASK              (configRTOS_TRACE_RECORDS - 1)
+#define TRACE_STREAM_MS         10
+#define TRACE_STREAM_BATCH      32
+#define TRACE_STREAM_STACK      1024
+/* lowest above idle, a busy cpu shows up as dropped records */
+#define TRACE_STREAM_PRIORITY   (RTOS_HIGHEST_PRIORITY - 1)
+
+typedef int (*trace_write_t)(const void *data, UINT32 len);
+
+volatile unsigned char rtos_trace_on = 0;
+
+/*
+ * The ring holds [trace_tail, trace_head), both count up freely. Hooks run in
+ * interrupts and with the scheduler locked, so a record is put with
+ * interrupts masked for a few instructions instead of taking a lock; the
+ * arm968 has no exclusive load/store to do better.
+ */
+static rtos_trace_rec_t trace_ring[configRTOS_TRACE_RECORDS];
+static UINT32 trace_head = 0;
+static UINT32 trace_tail = 0;
+static UINT8 trace_mode = RTOS_TRACE_MODE_RING;
+static UINT32 trace_written = 0;
+static UINT32 trace_dropped = 0;
+static UINT32 trace_overwritten = 0;
+/* dropped since the last record that made it, reported by RTOS_TRACE_DROPPED */
+static UINT32 trace_drop_pending = 0;
+
+static beken_thread_t trace_stream_thread = NULL;
+static int trace_uart = 0;
+static volatile UINT8 trace_stream_head = 0;
+
+#ifdef RTOS_TRACE_FLASH_ADDR
+static UINT32 trace_flash_off = 0;
+#endif
+
+static void trace_put(UINT32 ts, UINT8 type, UINT8 arg8, UINT16 arg16, UINT32 obj)
+{
+    rtos_trace_rec_t *rec = &trace_ring[trace_head & TRACE_MASK];
+
+    rec->ts = ts;
+    rec->type = type;
+    rec->arg8 = arg8;
+    rec->arg16 = arg16;
+    rec->obj = obj;
+    trace_head++;
+}
+
+void rtos_trace_event(unsigned char type, unsigned char arg8, unsigned int arg16, const void *obj)
+{
+    UINT32 ts, need;
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    ts = bk_timer_runtime_read();
+
+    if(trace_mode == RTOS_TRACE_MODE_STREAM)
+    {
+        need = trace_drop_pending ? 2 : 1;
+        if(configRTOS_TRACE_RECORDS - (trace_head - trace_tail) < need)
+        {
+            trace_drop_pending++;
+            trace_dropped++;
+            GLOBAL_INT_RESTORE();
+            return;
+        }
+
+        if(trace_drop_pending)
+        {
+            trace_put(ts, RTOS_TRACE_DROPPED, 0, 0, trace_drop_pending);
+            trace_drop_pending = 0;
+        }
+    }
+    else if(trace_head - trace_tail == configRTOS_TRACE_RECORDS)
+    {
+        trace_tail++;
+        trace_overwritten++;
+    }
+
+    trace_put(ts, type, arg8, (arg16 > 0xFFFF) ? 0xFFFF : (UINT16)arg16, (UINT32)obj);
+    trace_written++;
+    GLOBAL_INT_RESTORE();
+}
+
+void rtos_trace_user(uint16_t id, uint32_t value)
+{
+    RTOS_TRACE(RTOS_TRACE_USER, 0, id, value);
+}
+
+int rtos_trace_start(int mode)
+{
+    GLOBAL_INT_DECLARATION();
+
+    if(mode != RTOS_TRACE_MODE_RING && mode != RTOS_TRACE_MODE_STREAM)
+    {
+        return kParamErr;
+    }
+
+    GLOBAL_INT_DISABLE();
+    trace_mode = mode;
+    trace_head = 0;
+    trace_tail = 0;
+    trace_written = 0;
+    trace_dropped = 0;
+    trace_overwritten = 0;
+    trace_drop_pending = 0;
+    rtos_trace_on = 1;
+    GLOBAL_INT_RESTORE();
+
+    return kNoErr;
+}
+
+void rtos_trace_stop(void)
+{
+    rtos_trace_on = 0;
+}
+
+void rtos_trace_get_stat(rtos_trace_stat_t *stat)
+{
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    stat->written = trace_written;
+    stat->dropped = trace_dropped;
+    stat->overwritten = trace_overwritten;
+    stat->pending = trace_head - trace_tail;
+    GLOBAL_INT_RESTORE();
+}
+
+static int trace_write_head(trace_write_t write)
+{
+    rtos_trace_head_t head;
+
+    head.magic = RTOS_TRACE_MAGIC;
+    head.version = RTOS_TRACE_VERSION;
+    head.rec_size = sizeof(rtos_trace_rec_t);
+    head.ts_hz = configRUN_TIME_COUNTER_HZ;
+    head.records = configRTOS_TRACE_RECORDS;
+
+    return write(&head, sizeof(head));
+}
+
+/* records only carry the task handle, the names go out as a chunk of their own */
+static int trace_write_names(trace_write_t write)
+{
+    TaskStatus_t *status;
+    rtos_trace_chunk_t chunk;
+    rtos_trace_name_t name;
+    UBaseType_t num, i;
+    int ret = kNoErr;
+
+    num = uxTaskGetNumberOfTasks();
+    status = (TaskStatus_t *)os_malloc(num * sizeof(TaskStatus_t));
+    if(status == NULL)
+    {
+        return kNoMemoryErr;
+    }
+
+    num = uxTaskGetSystemState(status, num, NULL);
+    chunk.sync = RTOS_TRACE_SYNC_NAME;
+    chunk.count = num;
+    ret = write(&chunk, sizeof(chunk));
+
+    for(i = 0; i < num && ret == kNoErr; i++)
+    {
+        memset(&name, 0, sizeof(name));
+        name.task = (UINT32)status[i].xHandle;
+        strncpy(name.name, status[i].pcTaskName, RTOS_TRACE_NAME_LEN - 1);
+        ret = write(&name, sizeof(name));
+    }
+
+    os_free(status);
+
+    return ret;
+}
+
+static int trace_uart_write(const void *data, UINT32 len)
+{
+    return bk_uart_send((bk_uart_t)trace_uart, data, len);
+}
+
+static void trace_stream_main(beken_thread_arg_t arg)
+{
+    rtos_trace_rec_t batch[TRACE_STREAM_BATCH];
+    rtos_trace_chunk_t chunk;
+    UBaseType_t tasks = 0;
+    UINT32 count, i;
+    GLOBAL_INT_DECLARATION();
+
+    for(;;)
+    {
+        if(trace_stream_head)
+        {
+            trace_stream_head = 0;
+            tasks = 0;
+            trace_write_head(trace_uart_write);
+        }
+
+        if(tasks != uxTaskGetNumberOfTasks())
+        {
+            tasks = uxTaskGetNumberOfTasks();
+            trace_write_names(trace_uart_write);
+        }
+
+        do
+        {
+            GLOBAL_INT_DISABLE();
+            count = trace_head - trace_tail;
+            if(count > TRACE_STREAM_BATCH)
+            {
+                count = TRACE_STREAM_BATCH;
+            }
+            for(i = 0; i < count; i++)
+            {
+                batch[i] = trace_ring[(trace_tail + i) & TRACE_MASK];
+            }
+            trace_tail += count;
+
+            if(count == 0 && !rtos_trace_on)
+            {
+                trace_stream_thread = NULL;
+                GLOBAL_INT_RESTORE();
+                rtos_delete_thread(NULL);
+                return;
+            }
+            GLOBAL_INT_RESTORE();
+
+            if(count)
+            {
+                chunk.sync = RTOS_TRACE_SYNC_REC;
+                chunk.count = count;
+                trace_uart_write(&chunk, sizeof(chunk));
+                trace_uart_write(batch, count * sizeof(rtos_trace_rec_t));
+            }
+        }
+        while(count == TRACE_STREAM_BATCH);
+
+        rtos_delay_milliseconds(TRACE_STREAM_MS);
+    }
+}
+
+int rtos_trace_stream(int uart)
+{
+    int ret;
+
+    if(uart < BK_UART_1 || uart >= BK_UART_MAX)
+    {
+        return kParamErr;
+    }
+
+    trace_uart = uart;
+    trace_stream_head = 1;
+    ret = rtos_trace_start(RTOS_TRACE_MODE_STREAM);
+    if(ret != kNoErr || trace_stream_thread != NULL)
+    {
+        return ret;
+    }
+
+    ret = rtos_create_thread(&trace_stream_thread, TRACE_STREAM_PRIORITY, "trace",
+                             trace_stream_main, TRACE_STREAM_STACK, NULL);
+    if(ret != kNoErr)
+    {
+        rtos_trace_stop();
+        trace_stream_thread = NULL;
+    }
+
+    return ret;
+}
+
+#ifdef RTOS_TRACE_FLASH_ADDR
+static int trace_flash_write(const void *data, UINT32 len)
+{
+    if(len > RTOS_TRACE_FLASH_SIZE - trace_flash_off)
+    {
+        return kNoSpaceErr;
+    }
+
+    if(tkl_flash_write(RTOS_TRACE_FLASH_ADDR + trace_flash_off, (const UCHAR_T *)data, len) != OPRT_OK)
+    {
+        return kWriteErr;
+    }
+    trace_flash_off += len;
+
+    return kNoErr;
+}
+
+int rtos_trace_save(void)
+{
+    rtos_trace_chunk_t chunk;
+    UINT8 was_on = rtos_trace_on;
+    UINT32 tail, count, room, first;
+    int ret;
+
+    /* the stream task owns the tail */
+    if(trace_mode == RTOS_TRACE_MODE_STREAM && trace_stream_thread != NULL)
+    {
+        return kStateErr;
+    }
+
+    /* a hook runs with interrupts masked, none is half way through now */
+    rtos_trace_on = 0;
+
+    ret = (tkl_flash_erase(RTOS_TRACE_FLASH_ADDR, RTOS_TRACE_FLASH_SIZE) == OPRT_OK) ? kNoErr : kWriteErr;
+    trace_flash_off = 0;
+    if(ret == kNoErr)
+    {
+        ret = trace_write_head(trace_flash_write);
+    }
+    if(ret == kNoErr)
+    {
+        ret = trace_write_names(trace_flash_write);
+    }
+
+    if(ret == kNoErr)
+    {
+        /* keep the newest records that fit */
+        tail = trace_tail;
+        count = trace_head - tail;
+        room = (RTOS_TRACE_FLASH_SIZE - trace_flash_off - sizeof(chunk)) / sizeof(rtos_trace_rec_t);
+        if(count > room)
+        {
+            tail += count - room;
+            count = room;
+        }
+
+        chunk.sync = RTOS_TRACE_SYNC_REC;
+        chunk.count = count;
+        ret = trace_flash_write(&chunk, sizeof(chunk));
+
+        first = configRTOS_TRACE_RECORDS - (tail & TRACE_MASK);
+        if(first > count)
+        {
+            first = count;
+        }
+        if(ret == kNoErr && first)
+        {
+            ret = trace_flash_write(&trace_ring[tail & TRACE_MASK], first * sizeof(rtos_trace_rec_t));
+        }
+        if(ret == kNoErr && count > first)
+        {
+            ret = trace_flash_write(&trace_ring[0], (count - first) * sizeof(rtos_trace_rec_t));
+        }
+    }
+
+    os_printf("trace: saved %d bytes at %x, ret %d\r\n", trace_flash_off, RTOS_TRACE_FLASH_ADDR, ret);
+    rtos_trace_on = was_on;
+
+    return ret;
+}
+#else
+int rtos_trace_save(void)
+{
+    return kUnsupportedErr;
+}
+#endif
+
+#endif // configUSE_RTOS_TRACE
+
+// EOF
@@ -0,0 +1,543 @@
+#include "include.h"
+#include "arm_arch.h"
+#include <string.h>
+
+#include "sys_rtos.h"
+#include "task.h"
+#include "rtos_pub.h"
+#include "uart_pub.h"
+#include "timer_wheel.h"
+
+#define WHEEL_BITS          6
+#define WHEEL_SLOTS         (1 << WHEEL_BITS)
+#define WHEEL_MASK          (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS        5
+/* furthest a timer is placed, one further out comes back to the last level */
+#define WHEEL_RANGE         ((1UL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+#define WHEEL_SHIFT(level)  (WHEEL_BITS * (level))
+
+enum
+{
+    WHEEL_BUSY = 0,         /* the worker looks at the wheel again before it sleeps */
+    WHEEL_WAIT,             /* sleeps until wheel_wake */
+    WHEEL_WAIT_FOREVER,     /* the wheel is empty */
+};
+
+typedef timer_wheel_timer_t wtimer_t;
+
+extern uint32_t platform_is_in_interrupt_context(void);
+
+/*
+ * A level 0 slot holds the timers of one tick, a level n slot those of 64^n
+ * ticks. A timer is put into the lowest level its timeout fits in, relative
+ * to wheel_next, and a level n slot is moved down when wheel_next reaches the
+ * first tick it covers. Slots are lists linked through pprev so a timer comes
+ * out without knowing where it is; wheel_used tells the empty slots apart, so
+ * the worker finds the next tick with work in a few instructions per level.
+ */
+static wtimer_t *wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static uint64_t wheel_used[WHEEL_LEVELS];
+/* the timers of the tick processed last, the worker runs them before the next tick */
+static wtimer_t *wheel_expired = NULL;
+/* first tick not processed */
+static UINT32 wheel_next = 0;
+static UINT32 wheel_count = 0;
+
+static TaskHandle_t wheel_task = NULL;
+static UINT8 wheel_waiting = WHEEL_BUSY;
+static UINT32 wheel_wake = 0;
+
+static timer_wheel_stat_t wheel_stat;
+
+static UINT32 wheel_ticks(UINT32 time_ms)
+{
+    UINT32 ticks = time_ms / portTICK_PERIOD_MS + ((time_ms % portTICK_PERIOD_MS) ? 1 : 0);
+
+    return ticks ? ticks : 1;
+}
+
+static UINT32 wheel_now(void)
+{
+    if(platform_is_in_interrupt_context())
+    {
+        return xTaskGetTickCountFromISR();
+    }
+
+    return xTaskGetTickCount();
+}
+
+static void wheel_link(wtimer_t **head, wtimer_t *timer)
+{
+    timer->next = *head;
+    if(timer->next)
+    {
+        timer->next->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+}
+
+static void wheel_unlink(wtimer_t *timer)
+{
+    wtimer_t **pprev = timer->pprev;
+    UINT32 index;
+
+    *pprev = timer->next;
+    if(timer->next)
+    {
+        timer->next->pprev = pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+
+    /* it was the last timer of a slot */
+    if(*pprev == NULL && pprev >= &wheel[0][0] && pprev < &wheel[0][0] + WHEEL_LEVELS * WHEEL_SLOTS)
+    {
+        index = pprev - &wheel[0][0];
+        wheel_used[index / WHEEL_SLOTS] &= ~((uint64_t)1 << (index % WHEEL_SLOTS));
+    }
+}
+
+static void wheel_insert(wtimer_t *timer)
+{
+    UINT32 pos = timer->expiry;
+    UINT32 delta, slot;
+    int level = 0;
+
+    /* already due, the next tick processed runs it */
+    if((INT32)(pos - wheel_next) < 0)
+    {
+        pos = wheel_next;
+    }
+
+    delta = pos - wheel_next;
+    if(delta > WHEEL_RANGE)
+    {
+        delta = WHEEL_RANGE;
+        pos = wheel_next + WHEEL_RANGE;
+    }
+
+    while(level < WHEEL_LEVELS - 1 && delta >= (1UL << WHEEL_SHIFT(level + 1)))
+    {
+        level++;
+    }
+
+    slot = (pos >> WHEEL_SHIFT(level)) & WHEEL_MASK;
+    wheel_link(&wheel[level][slot], timer);
+    wheel_used[level] |= (uint64_t)1 << slot;
+}
+
+/* slots from 'from' on to the first used one, -1 when there is none */
+static int wheel_find(uint64_t used, UINT32 from)
+{
+    if(used == 0)
+    {
+        return -1;
+    }
+
+    if(from)
+    {
+        used = (used >> from) | (used << (WHEEL_SLOTS - from));
+    }
+
+    return __builtin_ctzll(used);
+}
+
+/* first tick from wheel_next on that moves or expires a slot with timers */
+static int wheel_next_work(UINT32 *tick)
+{
+    UINT32 shift, base, cand;
+    int level, dist, found = 0;
+
+    for(level = 0; level < WHEEL_LEVELS; level++)
+    {
+        shift = WHEEL_SHIFT(level);
+        /* the first tick from wheel_next on this level gets a look at */
+        base = wheel_next + ((0 - wheel_next) & ((1UL << shift) - 1));
+        dist = wheel_find(wheel_used[level], (base >> shift) & WHEEL_MASK);
+        if(dist < 0)
+        {
+            continue;
+        }
+
+        cand = base + ((UINT32)dist << shift);
+        if(!found || (INT32)(cand - *tick) < 0)
+        {
+            *tick = cand;
+            found = 1;
+        }
+    }
+
+    return found;
+}
+
+/* tick is the first one not processed, from wheel_next_work() */
+static void wheel_process(UINT32 tick)
+{
+    wtimer_t *list, *timer;
+    UINT32 slot;
+    int level;
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    wheel_next = tick;
+
+    /* higher levels first, their timers may drop into a slot moved below */
+    for(level = WHEEL_LEVELS - 1; level > 0; level--)
+    {
+        if(tick & ((1UL << WHEEL_SHIFT(level)) - 1))
+        {
+            continue;
+        }
+
+        slot = (tick >> WHEEL_SHIFT(level)) & WHEEL_MASK;
+        list = wheel[level][slot];
+        if(list == NULL)
+        {
+            continue;
+        }
+        list->pprev = &list;
+        wheel[level][slot] = NULL;
+        wheel_used[level] &= ~((uint64_t)1 << slot);
+
+        while((timer = list) != NULL)
+        {
+            wheel_unlink(timer);
+            wheel_insert(timer);
+            wheel_stat.cascaded++;
+
+            /* a slot may hold many timers, let interrupts in between two */
+            GLOBAL_INT_RESTORE();
+            GLOBAL_INT_DISABLE();
+        }
+    }
+
+    slot = tick & WHEEL_MASK;
+    wheel_expired = wheel[0][slot];
+    if(wheel_expired)
+    {
+        wheel_expired->pprev = &wheel_expired;
+    }
+    wheel[0][slot] = NULL;
+    wheel_used[0] &= ~((uint64_t)1 << slot);
+
+    wheel_next = tick + 1;
+    GLOBAL_INT_RESTORE();
+}
+
+static void wheel_run_expired(void)
+{
+    timer_wheel_handler_t function;
+    void *larg, *rarg;
+    wtimer_t *timer;
+    UINT32 batch = 0, late;
+    GLOBAL_INT_DECLARATION();
+
+    for(;;)
+    {
+        GLOBAL_INT_DISABLE();
+        timer = wheel_expired;
+        if(timer == NULL)
+        {
+            GLOBAL_INT_RESTORE();
+            break;
+        }
+
+        wheel_unlink(timer);
+        if((INT32)(timer->expiry - wheel_next) >= 0)
+        {
+            /* was out of reach of the wheel, goes round once more */
+            wheel_insert(timer);
+            GLOBAL_INT_RESTORE();
+            continue;
+        }
+
+        late = wheel_now() - timer->expiry;
+        if(late > wheel_stat.max_late)
+        {
+            wheel_stat.max_late = late;
+        }
+
+        /* a periodic timer stays on time, missed periods expire on the next ticks */
+        if(timer->periodic)
+        {
+            timer->expiry += timer->period;
+            wheel_insert(timer);
+        }
+        else
+        {
+            wheel_count--;
+        }
+
+        /* the timer may be restarted or deinit from here on */
+        function = timer->function;
+        larg = timer->larg;
+        rarg = timer->rarg;
+        wheel_stat.fired++;
+        GLOBAL_INT_RESTORE();
+
+        batch++;
+        if(function)
+        {
+            function(larg, rarg);
+        }
+    }
+
+    if(batch > wheel_stat.max_batch)
+    {
+        wheel_stat.max_batch = batch;
+    }
+}
+
+static void wheel_main(void *arg)
+{
+    UINT32 now, tick = 0;
+    int found;
+    GLOBAL_INT_DECLARATION();
+
+    for(;;)
+    {
+        now = xTaskGetTickCount();
+
+        GLOBAL_INT_DISABLE();
+        wheel_waiting = WHEEL_BUSY;
+        found = wheel_next_work(&tick);
+        if(!found || (INT32)(tick - now) > 0)
+        {
+            /* nothing up to now, later starts are placed from here */
+            if((INT32)(now + 1 - wheel_next) > 0)
+            {
+                wheel_next = now + 1;
+            }
+            wheel_wake = tick;
+            wheel_waiting = found ? WHEEL_WAIT : WHEEL_WAIT_FOREVER;
+            GLOBAL_INT_RESTORE();
+
+            ulTaskNotifyTake(pdTRUE, found ? (tick - now) : portMAX_DELAY);
+            continue;
+        }
+        GLOBAL_INT_RESTORE();
+
+        wheel_process(tick);
+        wheel_run_expired();
+    }
+}
+
+static void wheel_notify(void)
+{
+    signed portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+    if(wheel_task == NULL)
+    {
+        return;
+    }
+
+    if(platform_is_in_interrupt_context())
+    {
+        vTaskNotifyGiveFromISR(wheel_task, &xHigherPriorityTaskWoken);
+        portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+    }
+    else
+    {
+        xTaskNotifyGive(wheel_task);
+    }
+}
+
+int timer_wheel_init(uint32_t priority, uint32_t stack_size)
+{
+    if(wheel_task != NULL)
+    {
+        return kNoErr;
+    }
+
+    if(pdPASS != xTaskCreate(wheel_main, "timer_wheel", stack_size / sizeof(portSTACK_TYPE),
+                             NULL, priority, &wheel_task))
+    {
+        wheel_task = NULL;
+        return kGeneralErr;
+    }
+
+    return kNoErr;
+}
+
+void timer_wheel_init_timer(timer_wheel_timer_t *timer, uint32_t time_ms, int periodic,
+                            timer_wheel_handler_t function, void *larg, void *rarg)
+{
+    if(wheel_task == NULL && !platform_is_in_interrupt_context())
+    {
+        timer_wheel_init(configTIMER_WHEEL_TASK_PRIORITY, configTIMER_WHEEL_STACK_SIZE);
+    }
+
+    memset(timer, 0, sizeof(*timer));
+    timer->period = wheel_ticks(time_ms);
+    timer->periodic = periodic ? 1 : 0;
+    timer->function = function;
+    timer->larg = larg;
+    timer->rarg = rarg;
+}
+
+void timer_wheel_deinit_timer(timer_wheel_timer_t *timer)
+{
+    if(timer == NULL)
+    {
+        return;
+    }
+
+    timer_wheel_stop(timer);
+    timer->function = NULL;
+}
+
+int timer_wheel_start(timer_wheel_timer_t *timer)
+{
+    UINT32 now = wheel_now();
+    int wake;
+    GLOBAL_INT_DECLARATION();
+
+    if(timer == NULL)
+    {
+        return kParamErr;
+    }
+
+    GLOBAL_INT_DISABLE();
+    if(timer->pprev)
+    {
+        wheel_unlink(timer);
+    }
+    else if(wheel_count++ == 0)
+    {
+        /* nothing placed relative to the old wheel_next, start over from now */
+        wheel_next = now;
+    }
+
+    timer->expiry = now + timer->period;
+    wheel_insert(timer);
+
+    wake = (wheel_waiting == WHEEL_WAIT_FOREVER) ||
+           (wheel_waiting == WHEEL_WAIT && (INT32)(timer->expiry - wheel_wake) < 0);
+    if(wake)
+    {
+        wheel_waiting = WHEEL_BUSY;
+    }
+    GLOBAL_INT_RESTORE();
+
+    if(wake)
+    {
+        wheel_notify();
+    }
+
+    return kNoErr;
+}
+
+int timer_wheel_stop(timer_wheel_timer_t *timer)
+{
+    GLOBAL_INT_DECLARATION();
+
+    if(timer == NULL)
+    {
+        return kParamErr;
+    }
+
+    /* the worker wakes up for nothing at worst, no need to tell it */
+    GLOBAL_INT_DISABLE();
+    if(timer->pprev)
+    {
+        wheel_unlink(timer);
+        wheel_count--;
+    }
+    GLOBAL_INT_RESTORE();
+
+    return kNoErr;
+}
+
+int timer_wheel_change_period(timer_wheel_timer_t *timer, uint32_t time_ms)
+{
+    if(timer == NULL)
+    {
+        return kParamErr;
+    }
+
+    timer->period = wheel_ticks(time_ms);
+
+    return timer_wheel_start(timer);
+}
+
+int timer_wheel_is_active(timer_wheel_timer_t *timer)
+{
+    return timer != NULL && timer->pprev != NULL;
+}
+
+uint32_t timer_wheel_get_expiry(timer_wheel_timer_t *timer)
+{
+    if(timer == NULL)
+    {
+        return 0;
+    }
+
+    return timer->expiry;
+}
+
+/*
+ * The next work tick of a higher level is when its slot moves down, its
+ * timers expire up to 64^level ticks later. The slots of each level cover
+ * their ticks in order, so the earliest timer of a level is on the first
+ * used slot, and only that one is walked.
+ */
+uint32_t timer_wheel_next_expiry(void)
+{
+    UINT32 tick = portMAX_DELAY, shift, base, slot;
+    wtimer_t *timer;
+    int level, dist, found = 0;
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    for(level = 0; level < WHEEL_LEVELS; level++)
+    {
+        shift = WHEEL_SHIFT(level);
+        base = wheel_next + ((0 - wheel_next) & ((1UL << shift) - 1));
+        dist = wheel_find(wheel_used[level], (base >> shift) & WHEEL_MASK);
+        if(dist < 0)
+        {
+            continue;
+        }
+
+        slot = ((base >> shift) + dist) & WHEEL_MASK;
+        for(timer = wheel[level][slot]; timer != NULL; timer = timer->next)
+        {
+            if(!found || (INT32)(timer->expiry - tick) < 0)
+            {
+                tick = timer->expiry;
+                found = 1;
+            }
+        }
+    }
+    GLOBAL_INT_RESTORE();
+
+    return tick;
+}
+
+void timer_wheel_get_stat(timer_wheel_stat_t *stat)
+{
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    *stat = wheel_stat;
+    stat->active = wheel_count;
+    GLOBAL_INT_RESTORE();
+}
+
+void timer_wheel_dump(void)
+{
+    timer_wheel_stat_t stat;
+    int level;
+
+    timer_wheel_get_stat(&stat);
+    os_printf("timer wheel: %d active, %d fired, %d cascaded, batch max %d, late max %d ticks\r\n",
+              stat.active, stat.fired, stat.cascaded, stat.max_batch, stat.max_late);
+    for(level = 0; level < WHEEL_LEVELS; level++)
+    {
+        os_printf("  level %d: slots used %08x%08x\r\n", level,
+                  (UINT32)(wheel_used[level] >> 32), (UINT32)wheel_used[level]);
+    }
+}
+
+// EOF
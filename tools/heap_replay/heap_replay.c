@@ -0,0 +1,468 @@
+/*
+ * Replays a heap trace from the target against heap_4.c and heap_tlsf.c on
+ * the host, to compare how the allocators hold up under the same workload.
+ *
+ * The input is a console capture of os_heap_trace_dump() ("memtrace dump"),
+ * see heap_6.c; lines without an "ht " record are skipped. Each record is
+ * applied to both allocators in order, with the target block addresses
+ * mapped to the host blocks. Allocations that failed on the target are
+ * skipped, and so are frees of blocks allocated before the trace started.
+ *
+ * Build from the top of the tree (add -m32 where the host has it, so the
+ * block headers are the size they are on the target):
+ *
+ *   gcc -O2 -Itools/heap_replay/include -Icores/arduino/TuyaOS/adapter/include \
+ *       -It2Vendor/os/include -DREPLAY_HEAP_SIZE=163840 \
+ *       tools/heap_replay/heap_replay.c \
+ *       t2Vendor/os/FreeRTOSv9.0.0/FreeRTOS/Source/portable/MemMang/heap_4.c \
+ *       t2Vendor/os/FreeRTOSv9.0.0/FreeRTOS/Source/portable/MemMang/heap_tlsf.c \
+ *       -o heap_replay
+ *
+ *   ./heap_replay [-a] capture.log
+ *
+ * Only the main heap is replayed unless -a is given. REPLAY_HEAP_SIZE is the
+ * size of each host heap, 160 KB by default.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "heap_tlsf.h"
+
+#define OS_HEAP_TRACE_ALLOC     1
+#define OS_HEAP_TRACE_FREE      2
+#define OS_HEAP_TRACE_REALLOC   3
+
+/* live blocks, target address to host block */
+#define REPLAY_MAP_SIZE         (1 << 16)
+
+typedef struct
+{
+    UINT32 ptr;
+    UINT32 old;
+    UINT32 size;
+    UINT8 op;
+    UINT8 heap;
+} replay_rec_t;
+
+typedef struct
+{
+    UINT32 key;             /* 0 for an empty slot */
+    UINT32 size;
+    void *block;            /* NULL when the host allocation failed */
+} replay_map_t;
+
+typedef struct
+{
+    const char *name;
+    void (*init)(void);
+    void *(*malloc)(size_t size);
+    void (*free)(void *pv);
+    void *(*realloc)(void *pv, size_t size);
+    size_t (*available)(void);
+} replay_heap_t;
+
+typedef struct
+{
+    UINT32 ops;
+    UINT32 failed;          /* allocations that worked on the target but not here */
+    UINT32 live_bytes;
+    UINT32 peak_bytes;
+    size_t min_free;
+    uintptr_t low;          /* lowest and highest address handed out */
+    uintptr_t high;
+    double total_ns;
+    double max_ns;
+} replay_stat_t;
+
+void *pvPortMalloc(size_t xWantedSize);
+void vPortFree(void *pv);
+void *pvPortRealloc(void *pv, size_t xWantedSize);
+size_t xPortGetFreeHeapSize(void);
+
+static replay_rec_t *s_recs = NULL;
+static UINT32 s_rec_num = 0;
+static replay_map_t s_map[REPLAY_MAP_SIZE];
+
+static HEAP_HANDLE s_tlsf = NULL;
+static UINT8 s_tlsf_arena[REPLAY_HEAP_SIZE] __attribute__((aligned(8)));
+
+/* heap_4.c sets itself up on the first allocation */
+static void heap4_init(void)
+{
+    vPortFree(pvPortMalloc(4));
+}
+
+static void tlsf_init(void)
+{
+    heap_context_t ctx = {NULL, NULL, NULL};
+
+    tlsf_heap_init(&ctx);
+    if(0 != tlsf_heap_create(s_tlsf_arena, sizeof(s_tlsf_arena), &s_tlsf))
+    {
+        fprintf(stderr, "tlsf: cannot create a %d byte heap\n", (int)sizeof(s_tlsf_arena));
+        exit(1);
+    }
+}
+
+static void *tlsf_malloc(size_t size)
+{
+    return tlsf_heap_malloc(s_tlsf, size);
+}
+
+static void tlsf_free(void *pv)
+{
+    tlsf_heap_free(s_tlsf, pv);
+}
+
+static void *tlsf_realloc(void *pv, size_t size)
+{
+    return tlsf_heap_realloc(s_tlsf, pv, size);
+}
+
+static size_t tlsf_available(void)
+{
+    return tlsf_heap_available(s_tlsf);
+}
+
+static const replay_heap_t s_heaps[] =
+{
+    {"heap_4", heap4_init, pvPortMalloc, vPortFree, pvPortRealloc, xPortGetFreeHeapSize},
+    {"tlsf", tlsf_init, tlsf_malloc, tlsf_free, tlsf_realloc, tlsf_available},
+};
+
+static UINT32 map_hash(UINT32 key)
+{
+    return ((key >> 3) * 2654435761u) & (REPLAY_MAP_SIZE - 1);
+}
+
+static replay_map_t *map_find(UINT32 key)
+{
+    UINT32 i = map_hash(key);
+
+    while(s_map[i].key)
+    {
+        if(s_map[i].key == key)
+        {
+            return &s_map[i];
+        }
+        i = (i + 1) & (REPLAY_MAP_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+static void map_put(UINT32 key, void *block, UINT32 size)
+{
+    UINT32 i = map_hash(key);
+
+    while(s_map[i].key && s_map[i].key != key)
+    {
+        i = (i + 1) & (REPLAY_MAP_SIZE - 1);
+    }
+    s_map[i].key = key;
+    s_map[i].block = block;
+    s_map[i].size = size;
+}
+
+/* linear probing, the entries after the hole move up so lookups still find them */
+static void map_remove(replay_map_t *entry)
+{
+    UINT32 i = entry - s_map;
+    UINT32 j = i, home;
+
+    for(;;)
+    {
+        s_map[i].key = 0;
+        for(;;)
+        {
+            j = (j + 1) & (REPLAY_MAP_SIZE - 1);
+            if(0 == s_map[j].key)
+            {
+                return;
+            }
+            home = map_hash(s_map[j].key);
+            /* stays unless home lies cyclically outside (i, j] */
+            if((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+            {
+                continue;
+            }
+            break;
+        }
+        s_map[i] = s_map[j];
+        i = j;
+    }
+}
+
+static int load(FILE *fp, int all_heaps)
+{
+    char line[256], op;
+    const char *p;
+    unsigned int stamp, task, heap, ptr, old, size;
+    UINT32 max = 0;
+    replay_rec_t *rec;
+
+    while(fgets(line, sizeof(line), fp))
+    {
+        p = strstr(line, "ht ");
+        if(NULL == p || 7 != sscanf(p + 3, "%x %c %x %x %x %x %x", &stamp, &op, &task, &heap,
+                                    &ptr, &old, &size))
+        {
+            continue;
+        }
+        if(!all_heaps && 0 != heap)
+        {
+            continue;
+        }
+
+        if(s_rec_num == max)
+        {
+            max = max ? max * 2 : 4096;
+            s_recs = realloc(s_recs, max * sizeof(replay_rec_t));
+            if(NULL == s_recs)
+            {
+                return -1;
+            }
+        }
+        rec = &s_recs[s_rec_num ++];
+        rec->op = ('a' == op) ? OS_HEAP_TRACE_ALLOC : ('f' == op) ? OS_HEAP_TRACE_FREE :
+                  ('r' == op) ? OS_HEAP_TRACE_REALLOC : 0;
+        rec->ptr = ptr;
+        rec->old = old;
+        rec->size = size;
+        rec->heap = heap;
+
+        /* a realloc from NULL is a malloc, one to size 0 a free */
+        if(OS_HEAP_TRACE_REALLOC == rec->op && 0 == old)
+        {
+            rec->op = OS_HEAP_TRACE_ALLOC;
+        }
+        else if(OS_HEAP_TRACE_REALLOC == rec->op && 0 == size)
+        {
+            rec->op = OS_HEAP_TRACE_FREE;
+            rec->ptr = old;
+        }
+    }
+
+    return 0;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void stat_block(replay_stat_t *stat, void *block, UINT32 size)
+{
+    if(NULL == block)
+    {
+        stat->failed ++;
+        return;
+    }
+
+    if(0 == stat->low || (uintptr_t)block < stat->low)
+    {
+        stat->low = (uintptr_t)block;
+    }
+    if((uintptr_t)block + size > stat->high)
+    {
+        stat->high = (uintptr_t)block + size;
+    }
+    stat->live_bytes += size;
+    if(stat->live_bytes > stat->peak_bytes)
+    {
+        stat->peak_bytes = stat->live_bytes;
+    }
+}
+
+/* biggest block the heap can still hand out */
+static size_t largest_free(const replay_heap_t *heap)
+{
+    size_t lo = 0, hi = heap->available() + 1, mid;
+    void *pv;
+
+    while(lo + 1 < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        pv = heap->malloc(mid);
+        if(pv)
+        {
+            heap->free(pv);
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static void replay(const replay_heap_t *heap, UINT32 *unknown, UINT32 *target_failed)
+{
+    replay_stat_t stat;
+    replay_rec_t *rec;
+    replay_map_t *entry;
+    void *block, *old_block;
+    UINT32 size;
+    size_t free_size;
+    double start, spent;
+    UINT32 i;
+
+    memset(&stat, 0, sizeof(stat));
+    memset(s_map, 0, sizeof(s_map));
+    *unknown = 0;
+    *target_failed = 0;
+
+    heap->init();
+    stat.min_free = heap->available();
+
+    for(i = 0; i < s_rec_num; i++)
+    {
+        rec = &s_recs[i];
+
+        if(OS_HEAP_TRACE_ALLOC == rec->op)
+        {
+            if(0 == rec->ptr)
+            {
+                (*target_failed) ++;
+                continue;
+            }
+            start = now_ns();
+            block = heap->malloc(rec->size);
+            spent = now_ns() - start;
+            stat_block(&stat, block, rec->size);
+            map_put(rec->ptr, block, rec->size);
+        }
+        else if(OS_HEAP_TRACE_FREE == rec->op)
+        {
+            if(0 == rec->ptr)
+            {
+                continue;
+            }
+            entry = map_find(rec->ptr);
+            if(NULL == entry)
+            {
+                (*unknown) ++;
+                continue;
+            }
+            start = now_ns();
+            if(entry->block)
+            {
+                heap->free(entry->block);
+                stat.live_bytes -= entry->size;
+            }
+            spent = now_ns() - start;
+            map_remove(entry);
+        }
+        else if(OS_HEAP_TRACE_REALLOC == rec->op)
+        {
+            /* on a failed realloc the old block stays where it was */
+            if(0 == rec->ptr)
+            {
+                (*target_failed) ++;
+                continue;
+            }
+            entry = map_find(rec->old);
+            if(NULL == entry)
+            {
+                (*unknown) ++;
+                continue;
+            }
+            old_block = entry->block;
+            size = entry->size;
+            map_remove(entry);
+            if(NULL == old_block)
+            {
+                map_put(rec->ptr, NULL, 0);
+                continue;
+            }
+            start = now_ns();
+            block = heap->realloc(old_block, rec->size);
+            spent = now_ns() - start;
+            if(NULL == block)
+            {
+                /* the old block lives on under the new address */
+                stat.failed ++;
+                map_put(rec->ptr, old_block, size);
+                continue;
+            }
+            stat.live_bytes -= size;
+            stat_block(&stat, block, rec->size);
+            map_put(rec->ptr, block, rec->size);
+        }
+        else
+        {
+            continue;
+        }
+
+        stat.ops ++;
+        stat.total_ns += spent;
+        if(spent > stat.max_ns)
+        {
+            stat.max_ns = spent;
+        }
+        free_size = heap->available();
+        if(free_size < stat.min_free)
+        {
+            stat.min_free = free_size;
+        }
+    }
+
+    printf("%-8s %u ops, %u failed, peak live %u B, min free %u B, span %u B, "
+           "largest free at end %u B, %.0f ns/op avg, %.0f max\n",
+           heap->name, stat.ops, stat.failed, stat.peak_bytes, (unsigned int)stat.min_free,
+           (unsigned int)(stat.high - stat.low), (unsigned int)largest_free(heap),
+           stat.ops ? stat.total_ns / stat.ops : 0, stat.max_ns);
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *fp;
+    int all_heaps = 0, i;
+    UINT32 unknown = 0, target_failed = 0;
+
+    if(argc > 1 && 0 == strcmp(argv[1], "-a"))
+    {
+        all_heaps = 1;
+        argc --;
+        argv ++;
+    }
+    if(argc != 2)
+    {
+        fprintf(stderr, "usage: heap_replay [-a] capture.log\n");
+        return 2;
+    }
+
+    fp = fopen(argv[1], "r");
+    if(NULL == fp)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    if(0 != load(fp, all_heaps))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    fclose(fp);
+
+    for(i = 0; i < sizeof(s_heaps) / sizeof(s_heaps[0]); i++)
+    {
+        replay(&s_heaps[i], &unknown, &target_failed);
+    }
+
+    printf("%u records, %u failed on the target, %u frees of blocks from before the trace\n",
+           s_rec_num, target_failed, unknown);
+
+    return 0;
+}
+
+// EOF
@@ -0,0 +1,31 @@
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stddef.h>
+#include "include.h"
+
+typedef long BaseType_t;
+
+/* heap_4.c on a static array of the size given to heap_replay */
+#ifndef REPLAY_HEAP_SIZE
+#define REPLAY_HEAP_SIZE                    (160 * 1024)
+#endif
+
+#define configSUPPORT_DYNAMIC_ALLOCATION    1
+#define configDYNAMIC_HEAP_SIZE             0
+#define configAPPLICATION_ALLOCATED_HEAP    0
+#define configTOTAL_HEAP_SIZE               REPLAY_HEAP_SIZE
+#define configUSE_MALLOC_FAILED_HOOK        0
+#define OSMALLOC_STATISTICAL                0
+
+#define portBYTE_ALIGNMENT                  8
+#define portBYTE_ALIGNMENT_MASK             0x0007
+
+#define configASSERT(x)                     assert(x)
+#define mtCOVERAGE_TEST_MARKER()
+#define traceMALLOC(pv, size)
+#define traceFREE(pv, size)
+
+#endif // INC_FREERTOS_H
+
+// EOF
@@ -0,0 +1,20 @@
+#ifndef _INCLUDE_H_
+#define _INCLUDE_H_
+
+/* host stand-in for the sdk include.h, just enough for heap_4.c and heap_tlsf.c */
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+typedef uint8_t u8;
+typedef uint32_t u32;
+
+#define ASSERT(x)           assert(x)
+
+#endif // _INCLUDE_H_
+
+// EOF
@@ -0,0 +1,9 @@
+#ifndef _MEM_PUB_H_
+#define _MEM_PUB_H_
+
+#define os_memcpy           memcpy
+#define os_memset           memset
+
+#endif // _MEM_PUB_H_
+
+// EOF
@@ -0,0 +1,16 @@
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+/* the replay runs on one thread */
+static inline void vTaskSuspendAll(void)
+{
+}
+
+static inline BaseType_t xTaskResumeAll(void)
+{
+    return 0;
+}
+
+#endif // INC_TASK_H
+
+// EOF
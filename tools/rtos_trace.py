@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+"""Convert an rtos_trace capture to a Chrome trace / Perfetto JSON timeline.
+
+The input is either a uart capture of rtos_trace_stream() or a dump of the
+flash area written by rtos_trace_save(). The format is described in
+t2Vendor/os/include/rtos_trace.h. Open the output in ui.perfetto.dev or
+chrome://tracing.
+
+    python3 tools/rtos_trace.py capture.bin -o trace.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b"RTRC"
+SYNC_REC = 0x5254
+SYNC_NAME = 0x4E54
+HEAD = struct.Struct("<IHHII")
+CHUNK = struct.Struct("<HH")
+REC = struct.Struct("<IBBHI")
+NAME = struct.Struct("<I16s")
+
+(TASK_IN, TASK_CREATE, TASK_DELETE, TASK_DELAY, QUEUE_SEND, QUEUE_SEND_FAILED,
+ QUEUE_RECEIVE, QUEUE_RECEIVE_FAILED, QUEUE_BLOCK_SEND, QUEUE_BLOCK_RECEIVE,
+ QUEUE_SEND_ISR, QUEUE_RECEIVE_ISR, ISR_ENTER, ISR_EXIT, SLEEP_BEGIN, SLEEP_END,
+ MUTEX_LOCK, MUTEX_LOCKED, MUTEX_UNLOCK, TKL_POST, TKL_FETCH, TKL_FETCHED,
+ USER, DROPPED) = range(1, 25)
+
+QUEUE_EVENTS = {
+    QUEUE_SEND: "send",
+    QUEUE_SEND_FAILED: "send failed",
+    QUEUE_RECEIVE: "receive",
+    QUEUE_RECEIVE_FAILED: "receive failed",
+    QUEUE_BLOCK_SEND: "block on send",
+    QUEUE_BLOCK_RECEIVE: "block on receive",
+    QUEUE_SEND_ISR: "send from isr",
+    QUEUE_RECEIVE_ISR: "receive from isr",
+}
+
+# queueQUEUE_TYPE_* of FreeRTOS
+QUEUE_TYPES = ["queue", "mutex", "counting semaphore", "binary semaphore",
+               "recursive mutex", "queue set"]
+
+PID = 1
+TID_CPU = 1
+TID_IRQ = 2
+
+
+def parse(data):
+    """Yield ("head", hz), ("names", [(task, name)]) and ("recs", [rec])."""
+    pos = 0
+    limit = 0xFFFF
+    while pos + CHUNK.size <= len(data):
+        if data[pos:pos + 4] == MAGIC and pos + HEAD.size <= len(data):
+            _, version, rec_size, hz, records = HEAD.unpack_from(data, pos)
+            if version == 1 and rec_size == REC.size:
+                limit = records
+                yield "head", hz
+                pos += HEAD.size
+                continue
+
+        sync, count = CHUNK.unpack_from(data, pos)
+        body = pos + CHUNK.size
+        if sync == SYNC_REC and 0 < count <= limit and body + count * REC.size <= len(data):
+            recs = [REC.unpack_from(data, body + i * REC.size) for i in range(count)]
+            # "TR" in log text on a shared uart, the types give it away
+            if all(1 <= r[1] <= DROPPED for r in recs):
+                yield "recs", recs
+                pos = body + count * REC.size
+                continue
+        elif sync == SYNC_NAME and 0 < count <= 64 and body + count * NAME.size <= len(data):
+            names = [NAME.unpack_from(data, body + i * NAME.size) for i in range(count)]
+            if all(n[1].split(b"\0")[0].isascii() for n in names):
+                yield "names", [(t, n.split(b"\0")[0].decode()) for t, n in names]
+                pos = body + count * NAME.size
+                continue
+
+        pos += 1
+
+
+class Timeline:
+    def __init__(self):
+        self.hz = 26000000
+        self.events = []
+        self.names = {}
+        self.tids = {}
+        self.last_ts = None
+        self.time = 0
+        self.current = None
+        self.run_start = 0
+        self.irqs = []
+        self.records = 0
+        self.dropped = 0
+
+    def tid(self, task):
+        if task not in self.tids:
+            self.tids[task] = len(self.tids) + 10
+        return self.tids[task]
+
+    def task_name(self, task):
+        return self.names.get(task, "task %08x" % task)
+
+    def us(self, ts):
+        # the counter wraps every 165s at 26MHz, a trace has a record far more often
+        if self.last_ts is not None:
+            self.time += (ts - self.last_ts) & 0xFFFFFFFF
+        self.last_ts = ts
+        return self.time * 1e6 / self.hz
+
+    def slice(self, tid, name, start, end, args=None):
+        ev = {"ph": "X", "pid": PID, "tid": tid, "name": name, "ts": start, "dur": end - start}
+        if args:
+            ev["args"] = args
+        self.events.append(ev)
+
+    def instant(self, tid, name, now, args=None, scope="t"):
+        ev = {"ph": "i", "pid": PID, "tid": tid, "name": name, "ts": now, "s": scope}
+        if args:
+            ev["args"] = args
+        self.events.append(ev)
+
+    def async_ev(self, ph, cat, name, ident, now, args=None):
+        ev = {"ph": ph, "pid": PID, "cat": cat, "name": name, "id": ident, "ts": now}
+        if args:
+            ev["args"] = args
+        self.events.append(ev)
+
+    def record(self, ts, kind, arg8, arg16, obj):
+        now = self.us(ts)
+        self.records += 1
+        tid = self.tid(self.current) if self.current is not None else TID_CPU
+
+        if kind == TASK_IN:
+            if self.current is not None:
+                name = self.task_name(self.current)
+                self.slice(TID_CPU, name, self.run_start, now)
+                self.slice(self.tid(self.current), "running", self.run_start, now)
+            self.current = obj
+            self.run_start = now
+            self.tid(obj)
+        elif kind == TASK_CREATE:
+            self.instant(tid, "create " + self.task_name(obj), now, {"priority": arg16})
+        elif kind == TASK_DELETE:
+            self.instant(tid, "delete " + self.task_name(obj), now)
+        elif kind == TASK_DELAY:
+            self.instant(tid, "delay", now, {"ticks": arg16})
+        elif kind in QUEUE_EVENTS:
+            qtype = QUEUE_TYPES[arg8] if arg8 < len(QUEUE_TYPES) else str(arg8)
+            where = TID_IRQ if kind in (QUEUE_SEND_ISR, QUEUE_RECEIVE_ISR) else tid
+            self.instant(where, "%s %s" % (qtype, QUEUE_EVENTS[kind]), now,
+                         {"object": "%08x" % obj})
+        elif kind == ISR_ENTER:
+            self.irqs.append((arg8, now))
+        elif kind == ISR_EXIT:
+            if self.irqs:
+                irq, start = self.irqs.pop()
+                self.slice(TID_IRQ, "irq %d" % irq, start, now)
+        elif kind == SLEEP_BEGIN:
+            self.async_ev("b", "sleep", "tickless sleep", "sleep", now, {"expected ticks": arg16})
+        elif kind == SLEEP_END:
+            self.async_ev("e", "sleep", "tickless sleep", "sleep", now)
+        elif kind == MUTEX_LOCK:
+            self.async_ev("b", "mutex", "wait %08x" % obj, "%08x/%d" % (obj, tid), now,
+                          {"task": self.task_name(self.current or 0)})
+        elif kind == MUTEX_LOCKED:
+            self.async_ev("e", "mutex", "wait %08x" % obj, "%08x/%d" % (obj, tid), now)
+            if arg8:
+                self.async_ev("b", "mutex", "held %08x" % obj, "%08x" % obj, now,
+                              {"task": self.task_name(self.current or 0)})
+        elif kind == MUTEX_UNLOCK:
+            self.async_ev("e", "mutex", "held %08x" % obj, "%08x" % obj, now)
+        elif kind == TKL_POST:
+            self.instant(tid, "tkl post" if arg8 else "tkl post failed", now,
+                         {"queue": "%08x" % obj})
+        elif kind == TKL_FETCH:
+            self.async_ev("b", "queue", "fetch %08x" % obj, "%08x/%d" % (obj, tid), now)
+        elif kind == TKL_FETCHED:
+            self.async_ev("e", "queue", "fetch %08x" % obj, "%08x/%d" % (obj, tid), now,
+                          {"ok": bool(arg8)})
+        elif kind == USER:
+            self.instant(tid, "user %d" % arg16, now, {"value": obj})
+        elif kind == DROPPED:
+            self.dropped += obj
+            self.instant(TID_CPU, "%d records dropped" % obj, now, scope="g")
+
+    def finish(self):
+        meta = [
+            {"ph": "M", "pid": PID, "name": "process_name", "args": {"name": "t2"}},
+            {"ph": "M", "pid": PID, "tid": TID_CPU, "name": "thread_name", "args": {"name": "cpu"}},
+            {"ph": "M", "pid": PID, "tid": TID_IRQ, "name": "thread_name", "args": {"name": "irq"}},
+        ]
+        for task, tid in self.tids.items():
+            meta.append({"ph": "M", "pid": PID, "tid": tid, "name": "thread_name",
+                         "args": {"name": self.task_name(task)}})
+        return {"traceEvents": meta + self.events, "displayTimeUnit": "ns"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("input", help="uart capture or flash dump")
+    ap.add_argument("-o", "--output", help="json file, stdout by default")
+    args = ap.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    tl = Timeline()
+    for kind, value in parse(data):
+        if kind == "head":
+            tl.hz = value
+        elif kind == "names":
+            tl.names.update(value)
+        else:
+            for rec in value:
+                tl.record(*rec)
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    json.dump(tl.finish(), out)
+    if args.output:
+        out.close()
+
+    print("%d records, %d tasks, %d dropped, %.3f s" %
+          (tl.records, len(tl.tids), tl.dropped, tl.time / tl.hz), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,8 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#define configTIMER_TASK_PRIORITY   6
+
+#endif // FREERTOS_CONFIG_H
+
+// EOF
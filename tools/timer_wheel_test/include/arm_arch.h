@@ -0,0 +1,11 @@
+#ifndef _ARM_ARCH_H_
+#define _ARM_ARCH_H_
+
+/* the test runs on one thread, there is nothing to lock out */
+#define GLOBAL_INT_DECLARATION()    int global_int_unused
+#define GLOBAL_INT_DISABLE()        ((void)0)
+#define GLOBAL_INT_RESTORE()        ((void)global_int_unused)
+
+#endif // _ARM_ARCH_H_
+
+// EOF
@@ -0,0 +1,16 @@
+#ifndef _INCLUDE_H_
+#define _INCLUDE_H_
+
+/* host stand-in for the sdk include.h, just enough for timer_wheel.c */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+
+#endif // _INCLUDE_H_
+
+// EOF
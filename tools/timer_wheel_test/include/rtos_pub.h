@@ -0,0 +1,10 @@
+#ifndef _RTOS_PUB_H_
+#define _RTOS_PUB_H_
+
+#define kNoErr          0
+#define kGeneralErr     -1
+#define kParamErr       -6
+
+#endif // _RTOS_PUB_H_
+
+// EOF
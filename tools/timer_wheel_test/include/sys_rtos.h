@@ -0,0 +1,21 @@
+#ifndef _SYS_RTOS_H_
+#define _SYS_RTOS_H_
+
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef void *TaskHandle_t;
+
+#define portBASE_TYPE               long
+#define portSTACK_TYPE              uint32_t
+#define portTICK_PERIOD_MS          2
+#define portMAX_DELAY               0xffffffffUL
+#define portEND_SWITCHING_ISR(x)    ((void)(x))
+
+#define pdFALSE                     0
+#define pdTRUE                      1
+#define pdPASS                      1
+
+#endif // _SYS_RTOS_H_
+
+// EOF
@@ -0,0 +1,52 @@
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include <setjmp.h>
+#include "sys_rtos.h"
+
+/*
+ * The worker task is run by hand: timer_wheel_test.c calls it and the wait
+ * at the end of its loop jumps back out with the ticks it asked to sleep.
+ */
+extern uint32_t test_tick;
+extern uint32_t test_wait;
+extern jmp_buf test_worker;
+
+static inline uint32_t xTaskGetTickCount(void)
+{
+    return test_tick;
+}
+
+static inline uint32_t xTaskGetTickCountFromISR(void)
+{
+    return test_tick;
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, uint32_t wait)
+{
+    (void)clear;
+    test_wait = wait;
+    longjmp(test_worker, 1);
+}
+
+static inline BaseType_t xTaskCreate(void (*code)(void *), const char *name, uint32_t depth,
+                                     void *arg, uint32_t priority, TaskHandle_t *handle)
+{
+    (void)code; (void)name; (void)depth; (void)arg; (void)priority;
+    *handle = (TaskHandle_t)1;
+    return pdPASS;
+}
+
+static inline void xTaskNotifyGive(TaskHandle_t task)
+{
+    (void)task;
+}
+
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    (void)task; (void)woken;
+}
+
+#endif // INC_TASK_H
+
+// EOF
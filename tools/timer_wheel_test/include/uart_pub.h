@@ -0,0 +1,10 @@
+#ifndef _UART_PUB_H_
+#define _UART_PUB_H_
+
+#include <stdio.h>
+
+#define os_printf       printf
+
+#endif // _UART_PUB_H_
+
+// EOF
@@ -0,0 +1,276 @@
+/*
+ * Host test of timer_wheel.c: runs 10000 timers through the wheel on a fake
+ * tick counter and checks every expiry against a model of the timers.
+ *
+ * The worker task is called by hand, its ulTaskNotifyTake() jumps back here
+ * with the ticks it would sleep (see include/task.h). Between two runs the
+ * test restarts, stops and re-periods random timers, from the callbacks too,
+ * then moves the tick to the wake, short of it or past it. The tick counter
+ * starts just before it wraps. A run fails on a callback before the expiry
+ * or of a stopped timer, a timer left due after the worker ran, a wake later
+ * than the next expiry, or a timer_wheel_next_expiry() other than the
+ * earliest expiry of the model.
+ *
+ * Build from the top of the tree:
+ *
+ *   gcc -O2 -Itools/timer_wheel_test/include -It2Vendor/os/include -It2Vendor/os \
+ *       tools/timer_wheel_test/timer_wheel_test.c -o timer_wheel_test
+ *
+ *   ./timer_wheel_test [seed] [steps] [oneshot]
+ *
+ * oneshot 1 runs one-shot timers of up to 49 days with no churn, to check the
+ * long timeouts on their own. The exit code is 1 when any check failed.
+ */
+#include <stdlib.h>
+
+#include "timer_wheel.c"
+
+#define TEST_TIMERS             10000
+#define TEST_ERRORS_SHOWN       10
+
+uint32_t test_tick;
+uint32_t test_wait;
+jmp_buf test_worker;
+
+typedef struct
+{
+    UINT32 expiry;
+    UINT32 period;
+    UINT8 active;
+    UINT8 periodic;
+} test_model_t;
+
+static timer_wheel_timer_t s_timer[TEST_TIMERS];
+static test_model_t s_model[TEST_TIMERS];
+static int s_oneshot = 0;
+static UINT32 s_fired = 0;
+static UINT32 s_errors = 0;
+
+uint32_t platform_is_in_interrupt_context(void)
+{
+    return 0;
+}
+
+static void test_error(const char *what, int i, UINT32 tick)
+{
+    if(s_errors++ < TEST_ERRORS_SHOWN)
+    {
+        printf("%s: timer %d tick %u now %u\n", what, i, (unsigned)tick, (unsigned)test_tick);
+    }
+}
+
+static UINT32 test_time_ms(void)
+{
+    int k = rand() % 100;
+
+    if(s_oneshot || k >= 95)
+    {
+        return (UINT32)rand() * 2u + (rand() & 1);  /* up to 49 days */
+    }
+    if(k < 40)
+    {
+        return rand() % 100;
+    }
+    if(k < 80)
+    {
+        return rand() % 60000;
+    }
+    return rand() % (3600 * 1000);
+}
+
+static void test_start(int i)
+{
+    timer_wheel_start(&s_timer[i]);
+    s_model[i].active = 1;
+    s_model[i].expiry = test_tick + s_model[i].period;
+}
+
+static void test_stop(int i)
+{
+    timer_wheel_stop(&s_timer[i]);
+    s_model[i].active = 0;
+}
+
+static void test_churn(void)
+{
+    int i = rand() % TEST_TIMERS;
+
+    if(rand() % 3 == 0)
+    {
+        test_stop(i);
+    }
+    else if(rand() % 10 == 0)
+    {
+        timer_wheel_change_period(&s_timer[i], test_time_ms());
+        s_model[i].period = s_timer[i].period;
+        s_model[i].active = 1;
+        s_model[i].expiry = test_tick + s_model[i].period;
+    }
+    else
+    {
+        test_start(i);
+    }
+}
+
+static void test_callback(void *larg, void *rarg)
+{
+    int i = (int)(intptr_t)larg;
+    int k = rand() % 100;
+
+    (void)rarg;
+    if(!s_model[i].active)
+    {
+        test_error("stopped timer fired", i, s_model[i].expiry);
+        return;
+    }
+    if((INT32)(s_model[i].expiry - test_tick) > 0)
+    {
+        test_error("fired early", i, s_model[i].expiry);
+    }
+
+    s_fired++;
+    if(s_model[i].periodic)
+    {
+        s_model[i].expiry += s_model[i].period;
+    }
+    else
+    {
+        s_model[i].active = 0;
+    }
+
+    /* start and stop other timers from the worker as users do */
+    if(!s_oneshot && k < 5)
+    {
+        test_start(rand() % TEST_TIMERS);
+    }
+    else if(!s_oneshot && k < 8)
+    {
+        test_stop(rand() % TEST_TIMERS);
+    }
+}
+
+static void test_run_worker(void)
+{
+    if(setjmp(test_worker) == 0)
+    {
+        wheel_main(NULL);
+    }
+}
+
+/* earliest expiry of the model, 0 when no timer is active */
+static int test_check(UINT32 *next)
+{
+    int i, found = 0;
+
+    for(i = 0; i < TEST_TIMERS; i++)
+    {
+        if(!s_model[i].active)
+        {
+            if(timer_wheel_is_active(&s_timer[i]))
+            {
+                test_error("stray active", i, 0);
+            }
+            continue;
+        }
+
+        if(!timer_wheel_is_active(&s_timer[i]))
+        {
+            test_error("not active", i, s_model[i].expiry);
+        }
+        if(!found || (INT32)(s_model[i].expiry - *next) < 0)
+        {
+            *next = s_model[i].expiry;
+            found = 1;
+        }
+    }
+
+    if(timer_wheel_next_expiry() != (found ? *next : portMAX_DELAY))
+    {
+        test_error("next expiry", -1, timer_wheel_next_expiry());
+    }
+
+    return found;
+}
+
+int main(int argc, char **argv)
+{
+    UINT32 steps = 100000, step, start, next = 0, wait;
+    timer_wheel_stat_t stat;
+    int i, k, active = 0;
+
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+    if(argc > 2)
+    {
+        steps = strtoul(argv[2], NULL, 0);
+    }
+    if(argc > 3)
+    {
+        s_oneshot = atoi(argv[3]);
+    }
+
+    test_tick = start = 0xFFFFF000u;
+    for(i = 0; i < TEST_TIMERS; i++)
+    {
+        s_model[i].periodic = s_oneshot ? 0 : rand() % 2;
+        timer_wheel_init_timer(&s_timer[i], test_time_ms(), s_model[i].periodic,
+                               test_callback, (void *)(intptr_t)i, NULL);
+        s_model[i].period = s_timer[i].period;
+        if(rand() % 4)
+        {
+            test_start(i);
+        }
+    }
+
+    for(step = 0; step < steps; step++)
+    {
+        test_run_worker();
+
+        for(i = 0; i < TEST_TIMERS; i++)
+        {
+            if(s_model[i].active && (INT32)(s_model[i].expiry - test_tick) <= 0)
+            {
+                test_error("missed", i, s_model[i].expiry);
+                test_stop(i);
+            }
+        }
+        if(test_check(&next) && (test_wait == portMAX_DELAY || (INT32)(test_tick + test_wait - next) > 0))
+        {
+            test_error("overslept", -1, next);
+        }
+
+        for(k = 0; !s_oneshot && k < 5; k++)
+        {
+            test_churn();
+        }
+        test_check(&next);
+
+        /* wake on time, early or late */
+        wait = (test_wait == portMAX_DELAY) ? 1000 : test_wait;
+        k = s_oneshot ? 0 : rand() % 10;
+        if(k < 6)
+        {
+            test_tick += wait ? wait : 1;
+        }
+        else if(k < 8)
+        {
+            test_tick += 1 + rand() % (wait + 1);
+        }
+        else
+        {
+            test_tick += wait + rand() % 5000;
+        }
+    }
+
+    for(i = 0; i < TEST_TIMERS; i++)
+    {
+        active += s_model[i].active;
+    }
+    timer_wheel_get_stat(&stat);
+    printf("%u steps over %u ticks: %u fired, %d active (wheel %u), %u cascaded, batch max %u, %u errors\n",
+           (unsigned)steps, (unsigned)(test_tick - start), (unsigned)s_fired, active,
+           (unsigned)stat.active, (unsigned)stat.cascaded, (unsigned)stat.max_batch, (unsigned)s_errors);
+
+    return s_errors ? 1 : 0;
+}
+
+// EOF